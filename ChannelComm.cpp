@@ -0,0 +1,276 @@
+/*
+ * ChannelComm.cpp
+ *
+ * This file implements logical channels multiplexed over a single SerialComm link, built on
+ * SerialComm's binary messages, with credit based flow control for each channel.
+ *
+ * Data frame:   kind (CHANNEL_DATA), channel, sequence number, message id, data
+ * Credit frame: kind (CHANNEL_CREDIT), channel, sequence number limit, max message length
+ * Sync frame:   kind (CHANNEL_SYNC), channel, next sequence number
+ *
+ * The limit is the receiver's next expected sequence number plus its free slots. Since the
+ * receiver always follows the sender's sequence numbers, a lost data frame just frees its slot
+ * again, and a sync frame (sent by a blocked sender) resynchronizes both ends after a restart.
+ */
+
+#include "ChannelComm.h"
+
+#define CHANNEL_CREDIT_SIZE 6
+#define CHANNEL_SYNC_SIZE   4
+
+// -------------------- Initialization --------------------
+
+ChannelComm::ChannelComm(SerialComm * serial_in)
+{
+    serial = serial_in;
+
+    // every channel starts closed, and without credit to send
+    memset(channels, 0, sizeof(channels));
+}
+
+bool ChannelComm::Begin()
+{
+    return serial->RegisterHandler(BIN_MESSAGE, CHANNEL_BIN_ID, Handle_Frame, this);
+}
+
+bool ChannelComm::Open(uint8_t channel, uint8_t * buffer, uint16_t size, uint16_t max_length, ChannelHandler_t handler, void * context)
+{
+    CHANNEL_t * chan = NULL;
+    uint16_t num_slots = 0;
+
+    if (channel >= CHANNEL_COUNT || NULL == buffer) return false;
+
+    chan = &channels[channel];
+
+    num_slots = size / ((uint32_t) max_length + CHANNEL_SLOT_HEADER);
+    if (0 == num_slots) return false;
+
+    chan->buffer = buffer;
+    chan->max_length = max_length;
+    chan->num_slots = (num_slots > 255) ? 255 : (uint8_t) num_slots;
+    chan->head = 0;
+    chan->count = 0;
+    chan->handler = handler;
+    chan->context = context;
+
+    // let a sender that's waiting know it can start
+    Send_Credit(channel);
+
+    return true;
+}
+
+// -------------------------- TX --------------------------
+
+bool ChannelComm::TX(uint8_t channel, uint8_t msg_id, const uint8_t * data, uint16_t length)
+{
+    CHANNEL_t * chan = NULL;
+    uint8_t header[CHANNEL_HEADER_SIZE] = {0};
+    BIN_SEGMENT_t segments[2] = {{header, CHANNEL_HEADER_SIZE}, {data, length}};
+
+    if (channel >= CHANNEL_COUNT || (NULL == data && 0 != length)) return false;
+
+    chan = &channels[channel];
+
+    // out of credit, ask for more in case the last grant was lost
+    if (0 == TXAvailable(channel)) {
+        chan->blocked = true;
+        if ((millis() - chan->sync_time) >= CHANNEL_SYNC_INTERVAL) Send_Sync(channel);
+        return false;
+    }
+
+    if (length > chan->peer_max_length) return false;
+
+    header[0] = CHANNEL_DATA;
+    header[1] = channel;
+    header[2] = (uint8_t) (chan->tx_seq >> 8);
+    header[3] = (uint8_t) chan->tx_seq;
+    header[4] = msg_id;
+
+    if (!serial->TX_Bin(CHANNEL_BIN_ID, segments, 2)) return false;
+
+    chan->tx_seq++;
+
+    return true;
+}
+
+uint16_t ChannelComm::TXAvailable(uint8_t channel)
+{
+    if (channel >= CHANNEL_COUNT || (int16_t) (channels[channel].tx_limit - channels[channel].tx_seq) <= 0) return 0;
+
+    return channels[channel].tx_limit - channels[channel].tx_seq;
+}
+
+void ChannelComm::Update()
+{
+    for (uint8_t i = 0; i < CHANNEL_COUNT; i++) {
+        if (channels[i].blocked && (millis() - channels[i].sync_time) >= CHANNEL_SYNC_INTERVAL) {
+            Send_Sync(i);
+        }
+    }
+}
+
+void ChannelComm::Send_Credit(uint8_t channel)
+{
+    CHANNEL_t * chan = &channels[channel];
+    uint16_t limit = chan->rx_seq + (chan->num_slots - chan->count);
+    uint8_t frame[CHANNEL_CREDIT_SIZE] = {CHANNEL_CREDIT, channel, (uint8_t) (limit >> 8), (uint8_t) limit,
+                                          (uint8_t) (chan->max_length >> 8), (uint8_t) chan->max_length};
+    BIN_SEGMENT_t segment = {frame, CHANNEL_CREDIT_SIZE};
+
+    serial->TX_Bin(CHANNEL_BIN_ID, &segment, 1);
+    chan->granted = limit;
+}
+
+void ChannelComm::Send_Sync(uint8_t channel)
+{
+    CHANNEL_t * chan = &channels[channel];
+    uint8_t frame[CHANNEL_SYNC_SIZE] = {CHANNEL_SYNC, channel, (uint8_t) (chan->tx_seq >> 8), (uint8_t) chan->tx_seq};
+    BIN_SEGMENT_t segment = {frame, CHANNEL_SYNC_SIZE};
+
+    serial->TX_Bin(CHANNEL_BIN_ID, &segment, 1);
+    chan->sync_time = millis();
+}
+
+// -------------------------- RX --------------------------
+
+void ChannelComm::Handle_Frame(SerialComm * serial, uint8_t msg_id, void * context)
+{
+    ChannelComm * mux = (ChannelComm *) context;
+    const uint8_t * frame = serial->binary_rx.bin_buffer;
+    uint16_t length = serial->binary_rx.bin_length;
+    CHANNEL_t * chan = NULL;
+
+    (void) msg_id;
+
+    // corrupted frames are ignored, a lost data frame's slot is freed by the next one
+    if (!serial->binary_rx.checksum_valid || length < CHANNEL_SYNC_SIZE || frame[1] >= CHANNEL_COUNT) return;
+
+    chan = &mux->channels[frame[1]];
+
+    switch (frame[0]) {
+    case CHANNEL_DATA:
+        mux->Read_Data(chan, frame, length);
+        break;
+    case CHANNEL_CREDIT:
+        mux->Read_Credit(chan, frame, length);
+        break;
+    case CHANNEL_SYNC:
+        // follow the sender's sequence numbers and answer with the current limit
+        if (NULL == chan->buffer) break;
+        chan->rx_seq = ((uint16_t) frame[2] << 8) | frame[3];
+        mux->Send_Credit(frame[1]);
+        break;
+    default:
+        break;
+    }
+}
+
+void ChannelComm::Read_Data(CHANNEL_t * chan, const uint8_t * frame, uint16_t length)
+{
+    uint16_t data_length = 0;
+    uint8_t * slot = NULL;
+
+    if (length < CHANNEL_HEADER_SIZE || NULL == chan->buffer) return;
+
+    data_length = length - CHANNEL_HEADER_SIZE;
+    chan->rx_seq = (((uint16_t) frame[2] << 8) | frame[3]) + 1;
+
+    // only possible if the sender ignored its credit (or after a restart)
+    if (chan->count >= chan->num_slots || data_length > chan->max_length) {
+        chan->overflows++;
+        return;
+    }
+
+    slot = Slot(chan, (chan->head + chan->count) % chan->num_slots);
+    slot[0] = frame[4];
+    slot[1] = (uint8_t) (data_length >> 8);
+    slot[2] = (uint8_t) data_length;
+    memcpy(slot + CHANNEL_SLOT_HEADER, frame + CHANNEL_HEADER_SIZE, data_length);
+
+    chan->count++;
+}
+
+void ChannelComm::Read_Credit(CHANNEL_t * chan, const uint8_t * frame, uint16_t length)
+{
+    uint16_t limit = 0;
+
+    if (length < CHANNEL_CREDIT_SIZE) return;
+
+    // a limit more than a full queue ahead is stale, from before one of the ends restarted
+    limit = ((uint16_t) frame[2] << 8) | frame[3];
+    if ((uint16_t) (limit - chan->tx_seq) > 255) return;
+
+    chan->tx_limit = limit;
+    chan->peer_max_length = ((uint16_t) frame[4] << 8) | frame[5];
+    if (limit != chan->tx_seq) chan->blocked = false;
+}
+
+// ----------------------- Consumer -----------------------
+
+uint8_t ChannelComm::Deliver(uint8_t channel, uint8_t max_messages)
+{
+    CHANNEL_t * chan = NULL;
+    uint8_t delivered = 0;
+    uint8_t * slot = NULL;
+
+    if (channel >= CHANNEL_COUNT || NULL == channels[channel].handler) return 0;
+
+    chan = &channels[channel];
+
+    while (delivered < max_messages && chan->count > 0) {
+        slot = Slot(chan, chan->head);
+        chan->handler(channel, slot[0], slot + CHANNEL_SLOT_HEADER, ((uint16_t) slot[1] << 8) | slot[2], chan->context);
+        Release(channel);
+        delivered++;
+    }
+
+    return delivered;
+}
+
+bool ChannelComm::Read(uint8_t channel, uint8_t * msg_id, uint8_t * buffer, uint16_t buffer_size, uint16_t * length)
+{
+    CHANNEL_t * chan = NULL;
+    uint8_t * slot = NULL;
+    uint16_t data_length = 0;
+
+    if (channel >= CHANNEL_COUNT || 0 == channels[channel].count) return false;
+
+    chan = &channels[channel];
+
+    slot = Slot(chan, chan->head);
+    data_length = ((uint16_t) slot[1] << 8) | slot[2];
+    if (data_length > buffer_size) return false;
+
+    *msg_id = slot[0];
+    *length = data_length;
+    memcpy(buffer, slot + CHANNEL_SLOT_HEADER, data_length);
+
+    Release(channel);
+
+    return true;
+}
+
+uint8_t ChannelComm::Queued(uint8_t channel)
+{
+    if (channel >= CHANNEL_COUNT) return 0;
+
+    return channels[channel].count;
+}
+
+void ChannelComm::Release(uint8_t channel)
+{
+    CHANNEL_t * chan = &channels[channel];
+    uint16_t limit = 0;
+
+    chan->head = (chan->head + 1) % chan->num_slots;
+    chan->count--;
+
+    // grant credit in batches of half the queue rather than a frame per message
+    limit = chan->rx_seq + (chan->num_slots - chan->count);
+    if ((uint16_t) (limit - chan->granted) >= (chan->num_slots + 1) / 2) Send_Credit(channel);
+}
+
+uint8_t * ChannelComm::Slot(CHANNEL_t * chan, uint8_t index)
+{
+    return chan->buffer + (uint32_t) index * (chan->max_length + CHANNEL_SLOT_HEADER);
+}
@@ -0,0 +1,116 @@
+/*
+ * ChannelComm.h
+ *
+ * This file declares logical channels multiplexed over a single SerialComm link, built on
+ * SerialComm's binary messages. Each channel has its own receive queue, handler, and flow
+ * control, so a subsystem that's slow to consume its messages only holds up its own channel.
+ *
+ * Flow control is credit based: the receiver tells the sender how many messages it may send
+ * on a channel (the sequence number limit), which is the number of free slots in the channel's
+ * queue, and grants more as the consumer frees them. A sender that runs out of credit has
+ * its TX() calls refused until then, while the other channels carry on.
+ *
+ * Like ReliableComm, the channels receive through SerialComm's dispatch table (see Dispatch()
+ * in SerialComm.h).
+ */
+
+#ifndef CHANNELCOMM_H
+#define CHANNELCOMM_H
+
+#include "SerialComm.h"
+
+#define CHANNEL_BIN_ID        253 // binary message id reserved for the channels
+
+// number of channels on a link
+#ifndef CHANNEL_COUNT
+#define CHANNEL_COUNT         4
+#endif
+
+#define CHANNEL_HEADER_SIZE   5   // kind, channel, sequence number (uint16, big endian), message id
+#define CHANNEL_SLOT_HEADER   3   // message id, length (uint16)
+#define CHANNEL_SYNC_INTERVAL 100 // milliseconds between requests for credit while blocked
+
+// delivers a message received on a channel
+typedef void (*ChannelHandler_t)(uint8_t channel, uint8_t msg_id, const uint8_t * data, uint16_t length, void * context);
+
+enum ChannelFrame_t : uint8_t {
+    CHANNEL_DATA,   // a message: header, then data
+    CHANNEL_CREDIT, // receiver to sender: channel, sequence number limit, max message length
+    CHANNEL_SYNC    // sender to receiver: channel, next sequence number, asks for credit
+};
+
+struct CHANNEL_t {
+    // receiver: a queue of fixed-size slots in the assigned buffer, each a slot header and the message data
+    uint8_t * buffer;
+    uint16_t max_length;
+    uint8_t num_slots;
+    uint8_t head; // oldest queued message
+    uint8_t count;
+    uint16_t rx_seq; // next expected sequence number
+    uint16_t granted; // last limit sent to the sender
+    ChannelHandler_t handler;
+    void * context;
+
+    // sender: may send while tx_seq is before tx_limit
+    uint16_t tx_seq;
+    uint16_t tx_limit;
+    uint16_t peer_max_length;
+    bool blocked;
+    uint32_t sync_time;
+
+    // statistics
+    uint32_t overflows; // messages dropped because the queue was full
+};
+
+class ChannelComm {
+public:
+    ChannelComm(SerialComm * serial_in);
+    ~ChannelComm() { };
+
+    // Register with the SerialComm dispatch table
+    bool Begin();
+
+    // Start receiving on a channel, queueing up to size / (max_length + CHANNEL_SLOT_HEADER) messages of up to
+    // max_length bytes in the buffer, false if the channel doesn't exist or the buffer doesn't fit a message
+    bool Open(uint8_t channel, uint8_t * buffer, uint16_t size, uint16_t max_length, ChannelHandler_t handler, void * context);
+
+    // Send a message on a channel, false if the receiver doesn't have room for it yet (try again later)
+    bool TX(uint8_t channel, uint8_t msg_id, const uint8_t * data, uint16_t length);
+
+    // Number of messages the receiver has room for on a channel
+    uint16_t TXAvailable(uint8_t channel);
+
+    // Pass up to max_messages queued messages on a channel to its handler, returns the number delivered
+    uint8_t Deliver(uint8_t channel, uint8_t max_messages);
+
+    // Take the oldest queued message on a channel instead, false if there isn't one or it doesn't fit
+    bool Read(uint8_t channel, uint8_t * msg_id, uint8_t * buffer, uint16_t buffer_size, uint16_t * length);
+
+    // Number of messages queued on a channel
+    uint8_t Queued(uint8_t channel);
+
+    // Ask for credit on blocked channels, call at a regular interval
+    void Update();
+
+    // Channel state and statistics
+    CHANNEL_t channels[CHANNEL_COUNT];
+
+private:
+    static void Handle_Frame(SerialComm * serial, uint8_t msg_id, void * context);
+
+    void Read_Data(CHANNEL_t * chan, const uint8_t * frame, uint16_t length);
+    void Read_Credit(CHANNEL_t * chan, const uint8_t * frame, uint16_t length);
+
+    // remove the oldest queued message, granting more credit once enough slots are free
+    void Release(uint8_t channel);
+
+    void Send_Credit(uint8_t channel);
+    void Send_Sync(uint8_t channel);
+
+    uint8_t * Slot(CHANNEL_t * chan, uint8_t index);
+
+    SerialComm * serial;
+
+};
+
+#endif /* CHANNELCOMM_H */
@@ -0,0 +1,170 @@
+/*
+ * Compress.cpp
+ *
+ * This file implements the LZ77 codec declared in Compress.h. The compressor is greedy: at
+ * each position the hash of the next three bytes gives the last position they were seen at,
+ * and if the bytes really match (and are close enough), the match is extended as far as it
+ * goes. Anything that isn't part of a match is sent as literals.
+ */
+
+#include "Compress.h"
+#include <string.h>
+
+// -------------------- Compression -----------------------
+
+static inline uint16_t LZHash(const uint8_t * bytes)
+{
+    uint32_t value = ((uint32_t) bytes[0] << 16) | ((uint32_t) bytes[1] << 8) | bytes[2];
+
+    return (uint16_t) ((value * 2654435761u) >> (32 - LZ_HASH_BITS));
+}
+
+// write literal bytes as runs of up to LZ_MAX_LITERALS, false if they don't fit
+static bool LZLiterals(const uint8_t * literals, uint16_t num_literals, uint8_t * output, uint16_t output_size, uint16_t * out)
+{
+    uint8_t run = 0;
+
+    while (num_literals > 0) {
+        run = (num_literals > LZ_MAX_LITERALS) ? LZ_MAX_LITERALS : (uint8_t) num_literals;
+        if (*out + 1 + run > output_size) return false;
+
+        output[(*out)++] = run - 1;
+        memcpy(output + *out, literals, run);
+
+        *out += run;
+        literals += run;
+        num_literals -= run;
+    }
+
+    return true;
+}
+
+uint16_t LZCompress(const uint8_t * input, uint16_t length, uint8_t * output, uint16_t output_size)
+{
+    uint16_t table[1 << LZ_HASH_BITS];
+    uint16_t in = 0;
+    uint16_t out = 0;
+    uint16_t literal_start = 0;
+    uint16_t hash = 0;
+    uint16_t ref = 0;
+    uint16_t offset = 0;
+    uint16_t match_length = 0;
+    uint16_t max_length = 0;
+
+    if (NULL == input || NULL == output) return 0;
+
+    memset(table, 0, sizeof(table));
+
+    while (length - in >= LZ_MIN_MATCH) {
+        hash = LZHash(input + in);
+        ref = table[hash];
+        table[hash] = in;
+
+        // table entries are only a hint, the bytes themselves must match
+        if (ref >= in || in - ref > LZ_MAX_OFFSET || 0 != memcmp(input + ref, input + in, LZ_MIN_MATCH)) {
+            in++;
+            continue;
+        }
+
+        max_length = (length - in > LZ_MAX_MATCH) ? LZ_MAX_MATCH : length - in;
+        match_length = LZ_MIN_MATCH;
+        while (match_length < max_length && input[ref + match_length] == input[in + match_length]) match_length++;
+
+        if (!LZLiterals(input + literal_start, in - literal_start, output, output_size, &out)) return 0;
+
+        offset = in - ref - 1;
+
+        if (match_length - 2 < 7) {
+            if (out + 2 > output_size) return 0;
+            output[out++] = (uint8_t) (((match_length - 2) << 5) | (offset >> 8));
+        } else {
+            if (out + 3 > output_size) return 0;
+            output[out++] = (uint8_t) ((7 << 5) | (offset >> 8));
+            output[out++] = (uint8_t) (match_length - 2 - 7);
+        }
+        output[out++] = (uint8_t) (offset & 0xFF);
+
+        in += match_length;
+        literal_start = in;
+    }
+
+    if (!LZLiterals(input + literal_start, length - literal_start, output, output_size, &out)) return 0;
+
+    return out;
+}
+
+// ------------------- Decompression ----------------------
+
+void LZResetDecoder(LZ_DECODER_t * decoder)
+{
+    decoder->state = LZ_CONTROL;
+    decoder->literals = 0;
+    decoder->match_length = 0;
+    decoder->match_offset = 0;
+}
+
+bool LZDecode(LZ_DECODER_t * decoder, const uint8_t * input, uint16_t length, uint8_t * output, uint16_t output_size, uint16_t * output_length)
+{
+    uint16_t out = *output_length;
+    uint16_t run = 0;
+    uint8_t control = 0;
+    const uint8_t * ref = NULL;
+
+    while (length > 0) {
+        switch (decoder->state) {
+        case LZ_CONTROL:
+            control = *input++;
+            length--;
+            if (control < LZ_MAX_LITERALS) {
+                decoder->literals = control + 1;
+                decoder->state = LZ_LITERALS;
+            } else {
+                decoder->match_length = (control >> 5) + 2;
+                decoder->match_offset = (uint16_t) (control & 0x1F) << 8;
+                decoder->state = (7 + 2 == decoder->match_length) ? LZ_MATCH_LENGTH : LZ_MATCH_OFFSET;
+            }
+            break;
+        case LZ_LITERALS:
+            run = (decoder->literals < length) ? decoder->literals : length;
+            if (out + run > output_size) return false;
+            memcpy(output + out, input, run);
+            out += run;
+            input += run;
+            length -= run;
+            decoder->literals -= run;
+            if (0 == decoder->literals) decoder->state = LZ_CONTROL;
+            break;
+        case LZ_MATCH_LENGTH:
+            decoder->match_length += *input++;
+            length--;
+            decoder->state = LZ_MATCH_OFFSET;
+            break;
+        case LZ_MATCH_OFFSET:
+            decoder->match_offset = (decoder->match_offset | *input++) + 1;
+            length--;
+            if (decoder->match_offset > out || out + decoder->match_length > output_size) return false;
+
+            // a match can overlap the bytes it produces (a repeated byte is offset 1), so copy it forwards
+            ref = output + out - decoder->match_offset;
+            if (decoder->match_offset >= decoder->match_length) {
+                memcpy(output + out, ref, decoder->match_length);
+                out += decoder->match_length;
+            } else {
+                for (uint16_t i = 0; i < decoder->match_length; i++) output[out++] = *ref++;
+            }
+            decoder->state = LZ_CONTROL;
+            break;
+        default:
+            return false;
+        }
+    }
+
+    *output_length = out;
+
+    return true;
+}
+
+bool LZDecodeComplete(const LZ_DECODER_t * decoder)
+{
+    return LZ_CONTROL == decoder->state;
+}
@@ -0,0 +1,58 @@
+/*
+ * Compress.h
+ *
+ * This file declares a small LZ77 codec (the LZF format) for compressing binary message
+ * payloads. Compression finds matches with a fixed-size hash table on the stack, and
+ * decompression needs no memory beyond its output, since matches are copied from the bytes
+ * already decoded. The decoder is incremental, so a payload can be decoded as it arrives.
+ *
+ * A control byte below LZ_MAX_LITERALS is followed by (control + 1) literal bytes. Otherwise
+ * its top three bits are the match length - 2 (where 7 means that a byte follows to add to
+ * it), and its low five bits and the next byte are the match offset - 1, counting back from
+ * the end of the output. Runs of a repeated byte are matches at offset 1.
+ */
+
+#ifndef COMPRESS_H
+#define COMPRESS_H
+
+#include <stdint.h>
+
+// number of match positions remembered while compressing (2 bytes each, on the stack)
+#ifndef LZ_HASH_BITS
+#define LZ_HASH_BITS    8
+#endif
+
+#define LZ_MAX_LITERALS 32   // literal bytes per control byte
+#define LZ_MIN_MATCH    3
+#define LZ_MAX_MATCH    264  // 2 + 7 + 255
+#define LZ_MAX_OFFSET   8192 // 13 bits
+
+enum LZState_t : uint8_t {
+    LZ_CONTROL,      // expecting a control byte
+    LZ_LITERALS,     // copying a run of literal bytes
+    LZ_MATCH_LENGTH, // expecting the byte that extends a long match
+    LZ_MATCH_OFFSET  // expecting the low byte of the match offset
+};
+
+// state kept between calls to LZDecode() while a payload arrives
+struct LZ_DECODER_t {
+    LZState_t state;
+    uint8_t literals; // left in the current run
+    uint16_t match_length;
+    uint16_t match_offset;
+};
+
+// Compress the input, returns the compressed length, or zero if it doesn't fit in output_size
+uint16_t LZCompress(const uint8_t * input, uint16_t length, uint8_t * output, uint16_t output_size);
+
+// Prepare the decoder for a new payload
+void LZResetDecoder(LZ_DECODER_t * decoder);
+
+// Decode the next bytes of a compressed payload, appending to the output and advancing output_length,
+// returns false if the payload is corrupt or won't fit in output_size
+bool LZDecode(LZ_DECODER_t * decoder, const uint8_t * input, uint16_t length, uint8_t * output, uint16_t output_size, uint16_t * output_length);
+
+// Check that the payload didn't end partway through a literal run or match
+bool LZDecodeComplete(const LZ_DECODER_t * decoder);
+
+#endif /* COMPRESS_H */
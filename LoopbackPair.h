@@ -0,0 +1,48 @@
+/*
+ * LoopbackPair.h
+ *
+ * This file declares a pair of SerialComm objects joined by two connected LoopbackStreams,
+ * for testing the layers built on SerialComm (ReliableComm, ChannelComm) end to end. The
+ * layers, and the binary RX buffers they need, are attached to serial_a and serial_b by the
+ * test itself.
+ */
+
+#ifndef LOOPBACKPAIR_H
+#define LOOPBACKPAIR_H
+
+#include "SerialComm.h"
+#include "LoopbackStream.h"
+
+#define LOOPBACK_PAIR_SIZE 2048 // bytes in flight towards each side
+
+class LoopbackPair {
+public:
+    LoopbackPair()
+        : stream_a(buffer_a, LOOPBACK_PAIR_SIZE)
+        , stream_b(buffer_b, LOOPBACK_PAIR_SIZE)
+        , serial_a(&stream_a)
+        , serial_b(&stream_b)
+    {
+        stream_a.Connect(&stream_b);
+    }
+
+    // Let both sides dispatch everything in flight, including whatever they send in reply
+    void Service()
+    {
+        while (stream_a.available() > 0 || stream_b.available() > 0) {
+            serial_b.RXAll(0, 0);
+            serial_a.RXAll(0, 0);
+        }
+    }
+
+    // stream_a holds what's been sent to a, and stream_b what's been sent to b, so writing to one delivers to the other
+    uint8_t buffer_a[LOOPBACK_PAIR_SIZE] = {0};
+    uint8_t buffer_b[LOOPBACK_PAIR_SIZE] = {0};
+    LoopbackStream stream_a;
+    LoopbackStream stream_b;
+
+    SerialComm serial_a;
+    SerialComm serial_b;
+};
+
+#endif /* LOOPBACKPAIR_H */
@@ -0,0 +1,78 @@
+/*
+ * LoopbackStream.h
+ *
+ * This file declares an in-memory Stream for testing and benchmarking SerialComm without any
+ * hardware in the loop. Bytes written to a stream are read back from it, or from its peer
+ * once two streams are connected, which gives two SerialComm objects a full duplex link.
+ * Tests can drop, repeat, or corrupt frames by reading them out with readBytes() and
+ * writing back whatever they like.
+ */
+
+#ifndef LOOPBACKSTREAM_H
+#define LOOPBACKSTREAM_H
+
+#include "Arduino.h"
+#include <stdint.h>
+
+class LoopbackStream : public Stream {
+public:
+    // The buffer holds the bytes written to this stream that haven't been read yet
+    LoopbackStream(uint8_t * buffer_in, uint32_t size_in)
+    {
+        buffer = buffer_in;
+        size = size_in;
+        destination = this;
+    }
+
+    // Connect two streams, so that what's written to each is read from the other
+    void Connect(LoopbackStream * peer)
+    {
+        destination = peer;
+        peer->destination = this;
+    }
+
+    // Writes that don't fit are cut short
+    size_t write(uint8_t new_byte)
+    {
+        return write(&new_byte, 1);
+    }
+
+    size_t write(const uint8_t * bytes, size_t num_bytes)
+    {
+        LoopbackStream * dest = destination;
+        uint32_t index = dest->tail % dest->size;
+        uint32_t first = 0;
+
+        if (num_bytes > dest->size - (dest->tail - dest->head)) num_bytes = dest->size - (dest->tail - dest->head);
+
+        // copy up to the end of the buffer, then wrap around to the start
+        first = (num_bytes < dest->size - index) ? num_bytes : dest->size - index;
+        memcpy(dest->buffer + index, bytes, first);
+        memcpy(dest->buffer, bytes + first, num_bytes - first);
+        dest->tail += num_bytes;
+
+        return num_bytes;
+    }
+
+    int available() { return (int) (tail - head); }
+    int read() { return (head != tail) ? buffer[head++ % size] : -1; }
+    int peek() { return (head != tail) ? buffer[head % size] : -1; }
+    void flush() { }
+
+    // Drop everything that hasn't been read
+    void clear() { head = tail; }
+
+    // Number of bytes that haven't been read
+    uint32_t bytes() { return tail - head; }
+
+    using Print::write;
+
+private:
+    LoopbackStream * destination;
+    uint8_t * buffer;
+    uint32_t size;
+    uint32_t head = 0;
+    uint32_t tail = 0;
+};
+
+#endif /* LOOPBACKSTREAM_H */
@@ -0,0 +1,183 @@
+/*
+ * ReliableComm.cpp
+ *
+ * This file implements a reliable, in-order message channel built on top of SerialComm's
+ * binary messages. Each message carries a sequence number, up to RELIABLE_WINDOW messages
+ * can be outstanding at once, and the receiver returns cumulative and selective ACKs.
+ * Unacknowledged messages are retransmitted on a timer and duplicates are suppressed.
+ *
+ * Data frame: kind (RELIABLE_DATA), sequence number, message id, data
+ * ACK frame:  kind (RELIABLE_ACK), next expected sequence number, selective ACK bitmap
+ *
+ * Bit i of the selective ACK bitmap is set if the message with sequence number
+ * (expected + 1 + i) has been received out of order and is being held.
+ */
+
+#include "ReliableComm.h"
+
+// -------------------- Initialization --------------------
+
+ReliableComm::ReliableComm(SerialComm * serial_in, ReliableHandler_t handler_in, void * context_in)
+{
+    serial = serial_in;
+    handler = handler_in;
+    context = context_in;
+
+    for (uint8_t i = 0; i < RELIABLE_WINDOW; i++) {
+        tx_slots[i].in_use = false;
+        tx_slots[i].acked = false;
+        rx_slots[i].in_use = false;
+    }
+}
+
+bool ReliableComm::Begin()
+{
+    return serial->RegisterHandler(BIN_MESSAGE, RELIABLE_BIN_ID, Handle_Frame, this);
+}
+
+// -------------------------- TX --------------------------
+
+bool ReliableComm::TX(uint8_t msg_id, const uint8_t * data, uint16_t length)
+{
+    RELIABLE_SLOT_t * slot = &tx_slots[next_seq % RELIABLE_WINDOW];
+
+    if (Pending() >= RELIABLE_WINDOW) return false;
+    if (length > RELIABLE_PAYLOAD_SIZE || (NULL == data && 0 != length)) return false;
+
+    // keep a copy for retransmission
+    slot->in_use = true;
+    slot->acked = false;
+    slot->msg_id = msg_id;
+    slot->length = length;
+    if (0 != length) memcpy(slot->data, data, length);
+
+    Send_Data(next_seq++);
+
+    return true;
+}
+
+void ReliableComm::Update()
+{
+    RELIABLE_SLOT_t * slot = NULL;
+
+    for (uint8_t seq = send_base; seq != next_seq; seq++) {
+        slot = &tx_slots[seq % RELIABLE_WINDOW];
+
+        if (!slot->acked && (millis() - slot->sent_time) >= RELIABLE_TIMEOUT) {
+            Send_Data(seq);
+            retransmissions++;
+        }
+    }
+}
+
+uint8_t ReliableComm::Pending()
+{
+    return (uint8_t) (next_seq - send_base);
+}
+
+void ReliableComm::Send_Data(uint8_t seq)
+{
+    RELIABLE_SLOT_t * slot = &tx_slots[seq % RELIABLE_WINDOW];
+    uint8_t header[RELIABLE_HEADER_SIZE] = {RELIABLE_DATA, seq, slot->msg_id};
+    BIN_SEGMENT_t segments[2] = {{header, RELIABLE_HEADER_SIZE}, {slot->data, slot->length}};
+
+    serial->TX_Bin(RELIABLE_BIN_ID, segments, 2);
+    slot->sent_time = millis();
+}
+
+void ReliableComm::Send_Ack()
+{
+    uint8_t frame[3] = {RELIABLE_ACK, expected_seq, 0};
+    BIN_SEGMENT_t segment = {frame, 3};
+
+    for (uint8_t i = 0; i < RELIABLE_WINDOW - 1; i++) {
+        if (rx_slots[(uint8_t) (expected_seq + 1 + i) % RELIABLE_WINDOW].in_use) frame[2] |= (1 << i);
+    }
+
+    serial->TX_Bin(RELIABLE_BIN_ID, &segment, 1);
+}
+
+// -------------------------- RX --------------------------
+
+void ReliableComm::Handle_Frame(SerialComm * serial, uint8_t msg_id, void * context)
+{
+    ReliableComm * reliable = (ReliableComm *) context;
+    const uint8_t * frame = serial->binary_rx.bin_buffer;
+    uint16_t length = serial->binary_rx.bin_length;
+
+    (void) msg_id;
+
+    // corrupted frames are ignored, the sender will retransmit
+    if (!serial->binary_rx.checksum_valid || length < RELIABLE_HEADER_SIZE) return;
+
+    if (RELIABLE_DATA == frame[0]) {
+        reliable->Read_Data(frame, length);
+    } else if (RELIABLE_ACK == frame[0]) {
+        reliable->Read_Ack(frame, length);
+    }
+}
+
+void ReliableComm::Read_Data(const uint8_t * frame, uint16_t length)
+{
+    uint8_t seq = frame[1];
+    uint8_t offset = (uint8_t) (seq - expected_seq);
+    uint16_t data_length = length - RELIABLE_HEADER_SIZE;
+    RELIABLE_SLOT_t * slot = &rx_slots[seq % RELIABLE_WINDOW];
+
+    if (data_length > RELIABLE_PAYLOAD_SIZE) return;
+
+    if (0 == offset) {
+        // deliver in order, followed by any held messages that are now in order
+        handler(frame[2], frame + RELIABLE_HEADER_SIZE, data_length, context);
+        expected_seq++;
+
+        slot = &rx_slots[expected_seq % RELIABLE_WINDOW];
+        while (slot->in_use) {
+            handler(slot->msg_id, slot->data, slot->length, context);
+            slot->in_use = false;
+            expected_seq++;
+            slot = &rx_slots[expected_seq % RELIABLE_WINDOW];
+        }
+    } else if (offset < RELIABLE_WINDOW && !slot->in_use) {
+        // hold a message that arrived out of order
+        slot->in_use = true;
+        slot->msg_id = frame[2];
+        slot->length = data_length;
+        memcpy(slot->data, frame + RELIABLE_HEADER_SIZE, data_length);
+    } else {
+        // already delivered or already held
+        duplicates++;
+    }
+
+    // always ACK, since the sender may have missed a previous ACK
+    Send_Ack();
+}
+
+void ReliableComm::Read_Ack(const uint8_t * frame, uint16_t length)
+{
+    uint8_t cumulative = frame[1];
+    uint8_t selective = frame[2];
+    uint8_t seq = 0;
+
+    (void) length;
+
+    // ignore stale ACKs that fall outside of the window
+    if ((uint8_t) (cumulative - send_base) > Pending()) return;
+
+    for (seq = send_base; seq != cumulative; seq++) {
+        tx_slots[seq % RELIABLE_WINDOW].acked = true;
+    }
+
+    for (uint8_t i = 0; i < RELIABLE_WINDOW - 1; i++) {
+        seq = cumulative + 1 + i;
+        if ((selective & (1 << i)) && (uint8_t) (seq - send_base) < Pending()) {
+            tx_slots[seq % RELIABLE_WINDOW].acked = true;
+        }
+    }
+
+    // slide the window past everything that's been acknowledged
+    while (send_base != next_seq && tx_slots[send_base % RELIABLE_WINDOW].acked) {
+        tx_slots[send_base % RELIABLE_WINDOW].in_use = false;
+        send_base++;
+    }
+}
@@ -0,0 +1,87 @@
+/*
+ * ReliableComm.h
+ *
+ * This file declares a reliable, in-order message channel built on top of SerialComm's
+ * binary messages. Each message carries a sequence number, up to RELIABLE_WINDOW messages
+ * can be outstanding at once, and the receiver returns cumulative and selective ACKs.
+ * Unacknowledged messages are retransmitted on a timer and duplicates are suppressed.
+ *
+ * Received messages are routed through SerialComm's dispatch table, see the note on servicing
+ * handlers above Dispatch() in SerialComm.h.
+ */
+
+#ifndef RELIABLECOMM_H
+#define RELIABLECOMM_H
+
+#include "SerialComm.h"
+
+#define RELIABLE_BIN_ID       254 // binary message id reserved for the channel
+#define RELIABLE_WINDOW       8   // max outstanding messages, at most 8 (one byte of selective ACKs)
+#define RELIABLE_PAYLOAD_SIZE 64  // max bytes per message
+#define RELIABLE_TIMEOUT      200 // milliseconds before retransmitting
+
+#define RELIABLE_HEADER_SIZE  3   // kind, sequence number, message id
+
+// delivers a received message, in order and exactly once
+typedef void (*ReliableHandler_t)(uint8_t msg_id, const uint8_t * data, uint16_t length, void * context);
+
+enum ReliableFrame_t : uint8_t {
+    RELIABLE_DATA,
+    RELIABLE_ACK
+};
+
+struct RELIABLE_SLOT_t {
+    bool in_use;
+    bool acked;
+    uint8_t msg_id;
+    uint16_t length;
+    uint32_t sent_time;
+    uint8_t data[RELIABLE_PAYLOAD_SIZE];
+};
+
+class ReliableComm {
+public:
+    ReliableComm(SerialComm * serial_in, ReliableHandler_t handler_in, void * context_in);
+    ~ReliableComm() { };
+
+    // Register with the SerialComm dispatch table
+    bool Begin();
+
+    // Queue and send a message, false if the window is full or the message is too long
+    bool TX(uint8_t msg_id, const uint8_t * data, uint16_t length);
+
+    // Retransmit any messages that have timed out, call at a regular interval
+    void Update();
+
+    // Number of messages sent but not yet acknowledged
+    uint8_t Pending();
+
+    // Statistics
+    uint32_t retransmissions = 0;
+    uint32_t duplicates = 0;
+
+private:
+    static void Handle_Frame(SerialComm * serial, uint8_t msg_id, void * context);
+
+    void Read_Data(const uint8_t * frame, uint16_t length);
+    void Read_Ack(const uint8_t * frame, uint16_t length);
+
+    void Send_Data(uint8_t seq);
+    void Send_Ack();
+
+    SerialComm * serial;
+    ReliableHandler_t handler;
+    void * context;
+
+    // sender: window of [send_base, next_seq)
+    RELIABLE_SLOT_t tx_slots[RELIABLE_WINDOW];
+    uint8_t send_base = 0;
+    uint8_t next_seq = 0;
+
+    // receiver: next in-order sequence number and out-of-order messages held until it arrives
+    RELIABLE_SLOT_t rx_slots[RELIABLE_WINDOW];
+    uint8_t expected_seq = 0;
+
+};
+
+#endif /* RELIABLECOMM_H */
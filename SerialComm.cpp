@@ -12,6 +12,14 @@
 
 #include "SerialComm.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__ARM_FEATURE_DSP) && defined(__ARM_FEATURE_SIMD32)
+#include <arm_acle.h>
+#endif
+
 // -------------------- Initialization --------------------
 
 SerialComm::SerialComm(Stream * stream_in)
@@ -21,6 +29,13 @@ SerialComm::SerialComm(Stream * stream_in)
     // explicity set the pointers to NULL
     binary_rx.bin_buffer = NULL;
     binary_tx.bin_buffer = NULL;
+    large_binary_rx.buffer = NULL;
+
+    for (uint8_t i = 0; i < HANDLER_TABLE_SIZE; i++) {
+        handlers[i].key = HANDLER_UNUSED;
+        handlers[i].handler = NULL;
+        handlers[i].context = NULL;
+    }
 }
 
 void SerialComm::UpdatePort(Stream * stream_in)
@@ -34,85 +49,89 @@ void SerialComm::AssignBinaryRXBuffer(uint8_t * buffer, uint16_t size)
     binary_rx.buffer_size = size;
 }
 
-void SerialComm::AssignBinaryTXBuffer(uint8_t * buffer, uint16_t size, uint16_t num_bytes)
+void SerialComm::AssignLargeBinaryRXBuffer(uint8_t bin_id, uint8_t * buffer, uint32_t size)
 {
-    binary_tx.bin_buffer = buffer;
-    binary_tx.buffer_size = size;
-    binary_tx.bin_length = num_bytes;
+    large_binary_rx.bin_id = bin_id;
+    large_binary_rx.buffer = buffer;
+    large_binary_rx.buffer_size = size;
+    ResetLargeRX();
 }
 
-// ----------------------- Helpers ------------------------
-
-inline bool SerialComm::GetNextChar(char * new_char)
+void SerialComm::AssignBinaryRXStream(BinStreamHandler_t handler, void * context)
 {
-    int read_ret = serial_stream->read();
-    if (read_ret == -1) return false;
-    *new_char = (char) read_ret;
-    UpdateChecksum((uint8_t) *new_char);
-    return true;
+    AssignBinaryRXStream(handler, NULL, context);
 }
 
-bool SerialComm::ReadSpecificChar(uint32_t timeout, char specific_char)
+void SerialComm::AssignBinaryRXStream(BinStreamHandler_t handler, BinStreamEndHandler_t end_handler, void * context)
 {
-    char new_char;
-
-    // wait until there's a character available
-    while (millis() < timeout && !serial_stream->available());
+    bin_stream_handler = handler;
+    bin_stream_end_handler = end_handler;
+    bin_stream_context = context;
+}
 
-    // verify that we get the expected char
-    if (!GetNextChar(&new_char) || specific_char != new_char) return false;
+void SerialComm::AssignCompressionBuffer(uint8_t * buffer, uint16_t size)
+{
+    compress_buffer = buffer;
+    compress_buffer_size = (NULL == buffer) ? 0 : size;
+}
 
-    return true;
+void SerialComm::AssignBinaryTXBuffer(uint8_t * buffer, uint16_t size, uint16_t num_bytes)
+{
+    binary_tx.bin_buffer = buffer;
+    binary_tx.buffer_size = size;
+    binary_tx.bin_length = num_bytes;
 }
 
 // -------------------------- RX --------------------------
 
 SerialMessage_t SerialComm::RX()
 {
-    ResetRX();
+    SerialMessage_t ret = NO_MESSAGE;
+
+    // abandon a partial message that hasn't finished arriving in time
+    if (RX_IDLE != rx_state && (millis() - rx_start) > rx_window) {
+        DropFrame();
+    }
 
-    if (!serial_stream->available()) return NO_MESSAGE;
+    // only consume the characters that have already arrived, the parser state is kept until the next call
+    while (true) {
+        // payloads are copied in bulk rather than parsed char by char
+        if (RX_PAYLOAD == rx_state) {
+            if (!Parse_Payload()) break;
+            continue;
+        }
 
-    uint32_t timeout = millis() + READ_TIMEOUT;
-    char rx_char = '\0';
+        if (!FillRXBuffer()) break;
 
-    ResetChecksum();
-    while (timeout > millis() && GetNextChar(&rx_char)) {
-        switch (rx_char) {
-        case ASCII_DELIMITER:
-            if (Read_ASCII(timeout)) {
-                return ASCII_MESSAGE;
-            } else {
-                return NO_MESSAGE;
-            }
-        case ACK_DELIMITER:
-            if (Read_Ack(timeout)) {
-                return ACK_MESSAGE;
-            } else {
-                return NO_MESSAGE;
-            }
-        case BIN_DELIMITER:
-            timeout += 900; // some binary messages take up to a second
-            if (Read_Bin(timeout)) {
-                return BIN_MESSAGE;
-            } else {
-                return NO_MESSAGE;
-            }
-        case STRING_DELIMITER:
-            if (Read_String(timeout)) {
-                return STRING_MESSAGE;
-            } else {
-                return NO_MESSAGE;
-            }
-        default:
-            ResetChecksum();
-            break;
+        // skip anything between messages in bulk
+        if (RX_IDLE == rx_state) {
+            SkipToDelimiter();
+            if (rx_buffer_head == rx_buffer_tail) continue;
+        }
+
+        if (rx_state >= RX_COMPACT_HEADER) {
+            ret = Parse_Compact();
+        } else {
+            ret = ParseChar((char) rx_buffer[rx_buffer_head++]);
+        }
+
+        // fragments of a large binary message are reassembled rather than returned
+        if (BIN_MESSAGE == ret && NULL != large_binary_rx.buffer && NULL == bin_stream_handler
+            && large_binary_rx.bin_id == binary_rx.bin_id) {
+            ret = Read_Fragment();
         }
+
+        if (NO_MESSAGE != ret) return ret;
     }
 
     return NO_MESSAGE;
 }
 
+bool SerialComm::RXInProgress()
+{
+    return RX_IDLE != rx_state;
+}
+
 void SerialComm::ResetRX()
 {
     ascii_rx.msg_id = 0;
@@ -129,86 +148,255 @@ void SerialComm::ResetTX()
     ascii_tx.buffer[0] = '\0';
 }
 
-bool SerialComm::Read_ASCII(uint32_t timeout)
+SerialMessage_t SerialComm::ParseChar(char rx_char)
 {
-    char id_buffer[4] = {0}; // uint8 up to 3 chars long
-    char rx_char = '\0';
-    unsigned int temp = 0;
-    int read_ret = -1;
+    bool valid = false;
+
+    if (RX_IDLE == rx_state) {
+        StartFrame(rx_char);
+        return NO_MESSAGE;
+    }
+
+    rx_frame_bytes++;
+
+    // the checksum covers everything from the delimiter to the semicolon before the checksum
+    if (RX_CHECKSUM != rx_state) UpdateRXChecksum((uint8_t) rx_char);
+
+    switch (rx_state) {
+    case RX_ID:
+        valid = Parse_ID(rx_char);
+        break;
+    case RX_LENGTH:
+        valid = Parse_Length(rx_char);
+        break;
+    case RX_ASCII_PARAMS:
+        valid = Parse_ASCII(rx_char);
+        break;
+    case RX_ACK_VALUE:
+        valid = Parse_Ack(rx_char);
+        break;
+    case RX_PAYLOAD_END:
+        valid = (';' == rx_char);
+        if (valid) rx_state = RX_CHECKSUM;
+        break;
+    case RX_CHECKSUM:
+        if (';' == rx_char) return FinishFrame(CheckChecksum());
+
+        // a malformed checksum still returns the message, but flagged as invalid, and the offending char is left
+        // in the RX buffer to be checked as the start of the next message
+        if (!AddFieldChar(rx_char, 5)) {
+            rx_buffer_head--;
+            return FinishFrame(false);
+        }
+        return NO_MESSAGE;
+    default:
+        break;
+    }
+
+    // on error, drop the message and check if the offending char starts a new one
+    if (!valid) {
+        rx_frame_bytes--;
+        DropFrame();
+        StartFrame(rx_char);
+    }
+
+    return NO_MESSAGE;
+}
+
+void SerialComm::StartFrame(char rx_char)
+{
+    ResetRXChecksum();
+
+    switch (rx_char) {
+    case ASCII_DELIMITER:
+        rx_type = ASCII_MESSAGE;
+        break;
+    case ACK_DELIMITER:
+        rx_type = ACK_MESSAGE;
+        break;
+    case BIN_DELIMITER:
+        // ensure the destination buffer is valid, the rest of the message is skipped as noise otherwise
+        if (binary_rx.bin_buffer == NULL && bin_stream_handler == NULL) {
+            discarded_bytes++;
+            return;
+        }
+        rx_type = BIN_MESSAGE;
+        break;
+    case COMPRESSED_BIN_DELIMITER:
+        // compressed payloads are always decoded into the buffer, even when streaming
+        if (binary_rx.bin_buffer == NULL) {
+            discarded_bytes++;
+            return;
+        }
+        rx_type = BIN_MESSAGE;
+        break;
+    case STRING_DELIMITER:
+        rx_type = STRING_MESSAGE;
+        break;
+    case FRAMING_DELIMITER:
+        rx_type = FRAMING_MESSAGE;
+        break;
+    case COMPACT_DELIMITER:
+        // a zero is only a frame start once compact framing is in use or offered, otherwise it's noise
+        if (FRAMING_COMPACT != framing && !negotiate_framing) {
+            discarded_bytes++;
+            return;
+        }
+        rx_type = NO_MESSAGE; // set by the header
+        break;
+    default:
+        discarded_bytes++; // a char that broke the previous message without starting a new one
+        return;
+    }
 
-    // read the message id
-    while (timeout > millis() && temp < 3) {
-        // check for delimiters
-        read_ret = serial_stream->peek();
-        if (-1 == read_ret) continue;
-        rx_char = (char) read_ret;
-        if (rx_char == ',' || rx_char == ';') break;
+    UpdateRXChecksum((uint8_t) rx_char);
+    ResetField();
+    ResetRX();
+
+    // ensure rx message structs are reset
+    binary_rx.bin_length = 0;
+    binary_rx.bin_id = 0;
+    string_rx.str_length = 0;
+    string_rx.str_id = 0;
 
-        // add to the id buffer
-        if (GetNextChar(&rx_char)) id_buffer[temp++] = rx_char;
+    rx_index = 0;
+    rx_length = 0;
+    rx_frame_bytes = 1;
+    rx_discard = false;
+    rx_streaming = false;
+    rx_compressed = (COMPRESSED_BIN_DELIMITER == rx_char);
+    LZResetDecoder(&rx_decoder);
+    rx_start = millis();
+    rx_window = (BIN_MESSAGE == rx_type) ? BIN_READ_TIMEOUT : READ_TIMEOUT;
+    rx_state = RX_ID;
+
+    if (COMPACT_DELIMITER == rx_char) {
+        rx_cobs_remaining = 0;
+        rx_cobs_zero = false;
+        rx_state = RX_COMPACT_HEADER;
     }
+}
 
-    // if the next char isn't a delimiter, there's been an error
-    rx_char = serial_stream->peek();
-    if (rx_char != ',' && rx_char != ';') return false;
+bool SerialComm::Parse_ID(char rx_char)
+{
+    uint16_t temp = 0;
+
+    // ASCII messages without parameters and framing messages end directly after the id
+    if (',' != rx_char && !((ASCII_MESSAGE == rx_type || FRAMING_MESSAGE == rx_type) && ';' == rx_char)) {
+        return AddFieldChar(rx_char, 3); // uint8 up to 3 chars long
+    }
 
     // convert the message id
-    if (1 != sscanf(id_buffer, "%u", &temp)) return false;
-    if (temp > 255) return false;
-    ascii_rx.msg_id = (uint8_t) temp;
+    if (!ConvertField(255, &temp)) return false;
+    ResetField();
 
-    // read the parameters into the buffer
-    while (timeout > millis()) {
-        if (!GetNextChar(&rx_char)) continue;
+    CheckDiscard((uint8_t) temp);
 
-        // check for special characters
+    switch (rx_type) {
+    case ASCII_MESSAGE:
+        ascii_rx.msg_id = (uint8_t) temp;
         if (';' == rx_char) {
-            ascii_rx.buffer[ascii_rx.buffer_index] = '\0'; // null terminate
-            ascii_rx.buffer_index = 0; // reset index to zero
+            rx_state = RX_CHECKSUM;
+        } else {
+            // the leading comma is handled with the rest of the parameters
+            rx_state = RX_ASCII_PARAMS;
+            return Parse_ASCII(rx_char);
+        }
+        break;
+    case ACK_MESSAGE:
+        ack_id = (uint8_t) temp;
+        rx_state = RX_ACK_VALUE;
+        break;
+    case BIN_MESSAGE:
+        binary_rx.bin_id = (uint8_t) temp;
+        rx_state = RX_LENGTH;
+        break;
+    case STRING_MESSAGE:
+        string_rx.str_id = (uint8_t) temp;
+        rx_state = RX_LENGTH;
+        break;
+    case FRAMING_MESSAGE:
+        rx_version = (uint8_t) temp;
+        rx_state = RX_CHECKSUM;
+        break;
+    default:
+        return false;
+    }
 
-            ascii_rx.checksum_valid = ReadChecksum(timeout);
+    return true;
+}
 
-            return true;
-        }
+void SerialComm::CheckDiscard(uint8_t msg_id)
+{
+    // when only dispatching, the rest of a message nobody has a handler for is parsed but not stored
+    if (!drop_unhandled || ACK_MESSAGE == rx_type || FRAMING_MESSAGE == rx_type || NULL != FindHandler(rx_type, msg_id)) {
+        return;
+    }
 
-        if (',' == rx_char) ascii_rx.num_params++;
+    rx_discard = !(BIN_MESSAGE == rx_type && NULL != large_binary_rx.buffer && large_binary_rx.bin_id == msg_id);
+}
 
-        // add character to the buffer
-        ascii_rx.buffer[ascii_rx.buffer_index++] = rx_char;
+bool SerialComm::Parse_Length(char rx_char)
+{
+    uint16_t temp = 0;
+
+    if (';' != rx_char) return AddFieldChar(rx_char, 5); // uint16 up to 5 chars long
+
+    // convert the length
+    if (!ConvertField(65535, &temp)) return false;
+    ResetField();
+
+    if (rx_discard) {
+        // the payload won't be stored, so there's no size limit
+    } else if (rx_compressed) {
+        // the decompressed length is counted as the payload is decoded, and limited by the decoder
+        binary_rx.bin_length = 0;
+    } else if (BIN_MESSAGE == rx_type) {
+        // ensure we won't overflow the buffer (streamed payloads aren't buffered)
+        if (NULL == bin_stream_handler && temp > binary_rx.buffer_size) return false;
+        binary_rx.bin_length = (uint16_t) temp;
+    } else {
+        // leave room to null-terminate the string
+        if (temp > (STRING_BUFFER_SIZE - 1)) return false;
+        string_rx.str_length = (uint16_t) temp;
+        string_rx.buffer[temp] = '\0';
     }
 
-    return false;
+    rx_streaming = (BIN_MESSAGE == rx_type && !rx_discard && NULL != bin_stream_handler);
+    rx_index = 0;
+    rx_length = (uint16_t) temp;
+    rx_state = (0 == rx_length) ? RX_PAYLOAD_END : RX_PAYLOAD;
+
+    return true;
 }
 
-bool SerialComm::Read_Ack(uint32_t timeout)
+bool SerialComm::Parse_ASCII(char rx_char)
 {
-    char id_buffer[4] = {0}; // uint8 up to 3 chars long
-    char rx_char = '\0';
-    unsigned int temp = 0;
-    int read_ret = -1;
+    if (';' == rx_char) {
+        ascii_rx.buffer[ascii_rx.buffer_index] = '\0'; // null terminate
+        ascii_rx.buffer_index = 0; // reset index to zero
+        rx_state = RX_CHECKSUM;
+        return true;
+    }
+
+    if (rx_discard) return true;
 
-    // read the message id
-    while (timeout > millis() && temp < 3) {
-        // check for delimiters
-        read_ret = serial_stream->peek();
-        if (-1 == read_ret) continue;
-        rx_char = (char) read_ret;
-        if (rx_char == ',') break;
+    // leave room to null-terminate the buffer
+    if (ascii_rx.buffer_index >= (ASCII_BUFFER_SIZE - 1)) return false;
 
-        // add to the id buffer
-        if (GetNextChar(&rx_char)) id_buffer[temp++] = rx_char;
+    if (',' == rx_char) {
+        if (ascii_rx.num_params < ASCII_PARAM_INDEX_SIZE) param_offsets[ascii_rx.num_params] = ascii_rx.buffer_index;
+        ascii_rx.num_params++;
     }
 
-    // if the next char isn't a comma, there's been an error
-    if (!ReadSpecificChar(timeout, ',')) return false;
+    // add character to the buffer
+    ascii_rx.buffer[ascii_rx.buffer_index++] = rx_char;
 
-    // convert the message id
-    if (1 != sscanf(id_buffer, "%u", &temp)) return false;
-    if (temp > 255) return false;
-    ack_id = (uint8_t) temp;
+    return true;
+}
 
-    // read the ack value
-    while (millis() < timeout && !GetNextChar(&rx_char));
+bool SerialComm::Parse_Ack(char rx_char)
+{
     if ('0' == rx_char) {
         ack_value = false;
     } else if ('1' == rx_char) {
@@ -218,195 +406,686 @@ bool SerialComm::Read_Ack(uint32_t timeout)
     }
 
     // the message should end with a semi-colon before the checksum
-    if (!ReadSpecificChar(timeout, ';')) return false;
-
-    ack_checksum = ReadChecksum(timeout);
+    rx_state = RX_PAYLOAD_END;
 
     return true;
 }
 
-bool SerialComm::Read_Bin(uint32_t timeout)
+bool SerialComm::Parse_Payload()
 {
-    char id_buffer[4] = {0}; // uint8 up to 3 chars long
-    char length_buffer[6] = {0};
-    char rx_char = '\0';
-    unsigned int temp = 0;
-    int read_ret = -1;
+    uint8_t * destination = (BIN_MESSAGE == rx_type) ? binary_rx.bin_buffer : (uint8_t *) string_rx.buffer;
+    uint16_t num_bytes = rx_length - rx_index;
+    uint16_t buffered = rx_buffer_tail - rx_buffer_head;
+    int available = 0;
 
-    // ensure rx message struct is reset
-    binary_rx.bin_length = 0;
-    binary_rx.bin_id = 0;
+    // streamed and compressed binary payloads are handled straight out of the RX buffer, discarded ones are skipped
+    if (rx_discard || rx_compressed || (BIN_MESSAGE == rx_type && NULL != bin_stream_handler)) {
+        if (!FillRXBuffer()) return false;
+
+        buffered = rx_buffer_tail - rx_buffer_head;
+        if (num_bytes > buffered) num_bytes = buffered;
+
+        if (!rx_discard) {
+            BlockChecksum(rx_buffer + rx_buffer_head, num_bytes, &rx_check_a, &rx_check_b);
+        }
 
-    // ensure the destination buffer is valid
-    if (binary_rx.bin_buffer == NULL) return false;
+        if (rx_discard) {
+            // skipped
+        } else if (rx_compressed) {
+            // drop a payload that's corrupt or decompresses past the end of the buffer
+            if (!Decode_Bin(rx_buffer + rx_buffer_head, num_bytes)) {
+                DropFrame();
+                return true;
+            }
+        } else {
+            bin_stream_handler(binary_rx.bin_id, rx_index, rx_buffer + rx_buffer_head, num_bytes, bin_stream_context);
+        }
 
-    // read the binary id
-    while (timeout > millis() && temp < 3) {
-        // check for delimiters
-        read_ret = serial_stream->peek();
-        if (-1 == read_ret) continue;
-        rx_char = (char) read_ret;
-        if (rx_char == ',') break;
+        rx_buffer_head += num_bytes;
+        rx_frame_bytes += num_bytes;
+        rx_index += num_bytes;
+        if (rx_index == rx_length) rx_state = RX_PAYLOAD_END;
 
-        // add to the id buffer
-        if (GetNextChar(&rx_char)) id_buffer[temp++] = rx_char;
+        return true;
     }
 
-    // if timed out, flush the buffer and return error
-    if (timeout <= millis()) {
-        serial_stream->flush();
-        return false;
+    if (buffered > 0) {
+        // take what's already been read from the stream
+        if (num_bytes > buffered) num_bytes = buffered;
+        memcpy(destination + rx_index, rx_buffer + rx_buffer_head, num_bytes);
+        rx_buffer_head += num_bytes;
+    } else {
+        // otherwise read straight into the destination
+        available = serial_stream->available();
+        if (available <= 0) return false;
+        if (num_bytes > available) num_bytes = (uint16_t) available;
+        num_bytes = serial_stream->readBytes(destination + rx_index, num_bytes);
+        if (0 == num_bytes) return false;
     }
 
-    // if the next char isn't a comma, there's been an error
-    if (!ReadSpecificChar(timeout, ',')) return false;
+    BlockChecksum(destination + rx_index, num_bytes, &rx_check_a, &rx_check_b);
+
+    rx_frame_bytes += num_bytes;
+    rx_index += num_bytes;
+    if (rx_index == rx_length) rx_state = RX_PAYLOAD_END;
 
-    // convert the binary id
-    if (1 != sscanf(id_buffer, "%u", &temp)) return false;
-    if (temp > 255) return false;
-    binary_rx.bin_id = (uint8_t) temp;
+    return true;
+}
 
-    // read the binary length
-    temp = 0;
-    while (timeout > millis() && temp < 5) {
-        // check for delimiters
-        read_ret = serial_stream->peek();
-        if (-1 == read_ret) continue;
-        rx_char = (char) read_ret;
-        if (rx_char == ';') break;
+SerialMessage_t SerialComm::Read_Fragment()
+{
+    const uint8_t * fragment = binary_rx.bin_buffer;
+    uint32_t total_length = 0;
+    uint32_t offset = 0;
+    uint16_t object_checksum = 0;
+    uint16_t num_bytes = 0;
+    uint8_t check_object_a = 0;
+    uint8_t check_object_b = 0;
+
+    // a corrupted fragment invalidates the whole object
+    if (!binary_rx.checksum_valid || binary_rx.bin_length < LARGE_BIN_HEADER_SIZE) {
+        ResetLargeRX();
+        return NO_MESSAGE;
+    }
 
-        // add to the length buffer
-        if (GetNextChar(&rx_char)) length_buffer[temp++] = rx_char;
+    // fragment header: total length, offset, and object checksum (big endian)
+    total_length = ((uint32_t) fragment[0] << 24) | ((uint32_t) fragment[1] << 16) | ((uint32_t) fragment[2] << 8) | fragment[3];
+    offset = ((uint32_t) fragment[4] << 24) | ((uint32_t) fragment[5] << 16) | ((uint32_t) fragment[6] << 8) | fragment[7];
+    object_checksum = ((uint16_t) fragment[8] << 8) | fragment[9];
+    num_bytes = binary_rx.bin_length - LARGE_BIN_HEADER_SIZE;
+
+    // the first fragment starts a new object
+    if (0 == offset) {
+        ResetLargeRX();
+        if (total_length > large_binary_rx.buffer_size) return NO_MESSAGE;
+        large_binary_rx.total_length = total_length;
+        large_binary_rx.object_checksum = object_checksum;
     }
 
-    // if timed out, flush the buffer and return error
-    if (timeout <= millis()) {
-        serial_stream->flush();
-        return false;
+    // fragments must arrive in order, belong to the same object, and fit in it
+    if (offset != large_binary_rx.bytes_received || total_length != large_binary_rx.total_length
+        || object_checksum != large_binary_rx.object_checksum || num_bytes > total_length - offset) {
+        ResetLargeRX();
+        return NO_MESSAGE;
     }
 
-    // if the next char isn't a semicolon, there's been an error
-    if (!ReadSpecificChar(timeout, ';')) return false;
+    memcpy(large_binary_rx.buffer + offset, fragment + LARGE_BIN_HEADER_SIZE, num_bytes);
+    large_binary_rx.bytes_received += num_bytes;
 
-    // convert the binary length
-    if (1 != sscanf(length_buffer, "%u", &temp)) return false;
-    if (temp > 65535) return false;
-    binary_rx.bin_length = (uint16_t) temp;
+    if (large_binary_rx.bytes_received < large_binary_rx.total_length) return NO_MESSAGE;
 
-    // ensure we won't overflow the buffer
-    if (binary_rx.bin_length > binary_rx.buffer_size) {
-        serial_stream->flush();
-        return false;
+    // verify the reassembled object
+    BlockChecksum(large_binary_rx.buffer, large_binary_rx.total_length, &check_object_a, &check_object_b);
+    large_binary_rx.checksum_valid = (object_checksum == (((uint16_t) check_object_a << 8) | (uint16_t) check_object_b));
+
+    return LARGE_BIN_MESSAGE;
+}
+
+void SerialComm::ResetLargeRX()
+{
+    large_binary_rx.total_length = 0;
+    large_binary_rx.bytes_received = 0;
+    large_binary_rx.object_checksum = 0;
+    large_binary_rx.checksum_valid = false;
+}
+
+SerialMessage_t SerialComm::FinishFrame(bool checksum_valid)
+{
+    if (rx_discard) {
+        rx_state = RX_IDLE;
+        return NO_MESSAGE;
     }
 
-    // read the binary section
-    temp = 0;
-    while (timeout > millis() && temp < binary_rx.bin_length) {
-        if (GetNextChar(&rx_char)) binary_rx.bin_buffer[temp++] = (uint8_t) rx_char;
+    switch (rx_type) {
+    case ASCII_MESSAGE:
+        ascii_rx.checksum_valid = checksum_valid;
+        break;
+    case ACK_MESSAGE:
+        ack_checksum = checksum_valid;
+        break;
+    case BIN_MESSAGE:
+        // a compressed payload must also end on a complete literal run or match
+        binary_rx.checksum_valid = checksum_valid && (!rx_compressed || LZDecodeComplete(&rx_decoder));
+        EndStream(binary_rx.checksum_valid ? STREAM_VALID : STREAM_INVALID);
+        break;
+    case STRING_MESSAGE:
+        string_rx.checksum_valid = checksum_valid;
+        break;
+    case FRAMING_MESSAGE:
+        // a peer offering compact framing can parse it, so if we've offered it too, switch to it and let the peer
+        // know that we have (offers are ignored when the application has chosen the framing itself)
+        rx_state = RX_IDLE;
+        if (!checksum_valid) return NO_MESSAGE;
+        peer_decompress = (0 != (rx_version & CAN_DECOMPRESS));
+        if (negotiate_framing && (rx_version & ~CAN_DECOMPRESS) >= COMPACT_VERSION && FRAMING_COMPACT != framing) {
+            framing = FRAMING_COMPACT;
+            NegotiateFraming();
+            return FRAMING_MESSAGE;
+        }
+        return NO_MESSAGE;
+    default:
+        break;
     }
 
-    // if timed out, flush the buffer and return error
-    if (timeout <= millis()) {
-        serial_stream->flush();
-        return false;
+    rx_state = RX_IDLE;
+
+    return rx_type;
+}
+
+// ------------------- Compact RX Parsing -----------------
+
+SerialMessage_t SerialComm::Parse_Compact()
+{
+    static const uint8_t implied_zero = 0;
+    const uint8_t * zero = NULL;
+    uint8_t rx_byte = 0;
+    uint16_t run = 0;
+
+    while (rx_buffer_head < rx_buffer_tail) {
+        rx_byte = rx_buffer[rx_buffer_head];
+
+        if (COMPACT_DELIMITER == rx_byte) {
+            // back to back delimiters between frames
+            if (RX_COMPACT_HEADER == rx_state && 0 == rx_index && 0 == rx_cobs_remaining && !rx_cobs_zero) {
+                rx_buffer_head++;
+                continue;
+            }
+
+            // a complete frame, otherwise the zero starts the next frame
+            if (RX_COMPACT_END == rx_state && 0 == rx_cobs_remaining) {
+                rx_buffer_head++;
+                return FinishFrame(rx_field_value == (((uint32_t) rx_check_a << 8) | rx_check_b));
+            }
+
+            DropFrame();
+            return NO_MESSAGE;
+        }
+
+        // a code byte gives the length of the block, which ends with an implied zero unless it's a full block
+        if (0 == rx_cobs_remaining) {
+            rx_buffer_head++;
+            rx_frame_bytes++;
+            if (rx_cobs_zero && !Decode_Compact(&implied_zero, 1)) {
+                DropFrame(); // and search for the next frame
+                return NO_MESSAGE;
+            }
+            rx_cobs_remaining = rx_byte - 1;
+            rx_cobs_zero = (0xFF != rx_byte);
+            continue;
+        }
+
+        // the rest of the block is decoded in bulk, stopping short of a zero from a truncated frame
+        run = rx_buffer_tail - rx_buffer_head;
+        if (run > rx_cobs_remaining) run = rx_cobs_remaining;
+        zero = (const uint8_t *) memchr(rx_buffer + rx_buffer_head, COMPACT_DELIMITER, run);
+        if (NULL != zero) run = zero - (rx_buffer + rx_buffer_head);
+
+        if (!Decode_Compact(rx_buffer + rx_buffer_head, run)) {
+            DropFrame();
+            return NO_MESSAGE;
+        }
+
+        rx_buffer_head += run;
+        rx_frame_bytes += run;
+        rx_cobs_remaining -= run;
     }
 
-    // the message should end with a semi-colon before the checksum
-    if (!ReadSpecificChar(timeout, ';')) return false;
+    return NO_MESSAGE;
+}
 
-    binary_rx.checksum_valid = ReadChecksum(timeout);
+bool SerialComm::Decode_Compact(const uint8_t * bytes, uint16_t num_bytes)
+{
+    uint16_t run = 0;
+
+    while (num_bytes > 0) {
+        switch (rx_state) {
+        case RX_COMPACT_HEADER:
+            UpdateRXChecksum(*bytes);
+            rx_header[rx_index++] = *bytes++;
+            num_bytes--;
+            if (COMPACT_HEADER_SIZE == rx_index && !Start_Compact()) return false;
+            break;
+        case RX_COMPACT_PAYLOAD:
+            run = rx_length - rx_index;
+            if (run > num_bytes) run = num_bytes;
+            if (!Store_Compact(bytes, run)) return false;
+            bytes += run;
+            num_bytes -= run;
+            rx_index += run;
+            if (rx_index == rx_length) {
+                rx_index = 0;
+                rx_state = RX_COMPACT_CHECKSUM;
+            }
+            break;
+        case RX_COMPACT_CHECKSUM:
+            rx_field_value = (rx_field_value << 8) | *bytes++;
+            num_bytes--;
+            if (2 == ++rx_index) rx_state = RX_COMPACT_END;
+            break;
+        default:
+            return false; // data after the checksum
+        }
+    }
 
     return true;
 }
 
-bool SerialComm::Read_String(uint32_t timeout)
+bool SerialComm::Start_Compact()
 {
-    char id_buffer[4] = {0}; // uint8 up to 3 chars long
-    char length_buffer[6] = {0};
-    char rx_char = '\0';
-    unsigned int temp = 0;
-    int read_ret = -1;
+    uint8_t msg_id = rx_header[1];
+    uint16_t length = ((uint16_t) rx_header[2] << 8) | rx_header[3];
+
+    switch (rx_header[0]) {
+    case ASCII_DELIMITER:
+        rx_type = ASCII_MESSAGE;
+        break;
+    case ACK_DELIMITER:
+        rx_type = ACK_MESSAGE;
+        break;
+    case BIN_DELIMITER:
+        if (binary_rx.bin_buffer == NULL && bin_stream_handler == NULL) return false;
+        rx_type = BIN_MESSAGE;
+        break;
+    case COMPRESSED_BIN_DELIMITER:
+        if (binary_rx.bin_buffer == NULL) return false;
+        rx_type = BIN_MESSAGE;
+        rx_compressed = true;
+        break;
+    case STRING_DELIMITER:
+        rx_type = STRING_MESSAGE;
+        break;
+    default:
+        return false;
+    }
 
-    // ensure rx message struct is reset
-    string_rx.str_length = 0;
-    string_rx.str_id = 0;
+    CheckDiscard(msg_id);
+
+    // the same limits as text framing, with the payload stored as it's decoded
+    switch (rx_type) {
+    case ASCII_MESSAGE:
+        ascii_rx.msg_id = msg_id;
+        if (!rx_discard) {
+            if (length > (ASCII_BUFFER_SIZE - 1)) return false;
+            ascii_rx.buffer[length] = '\0';
+        }
+        break;
+    case ACK_MESSAGE:
+        ack_id = msg_id;
+        if (1 != length) return false;
+        break;
+    case BIN_MESSAGE:
+        binary_rx.bin_id = msg_id;
+        rx_window = BIN_READ_TIMEOUT;
+        if (rx_compressed) {
+            binary_rx.bin_length = 0;
+        } else if (!rx_discard) {
+            if (NULL == bin_stream_handler && length > binary_rx.buffer_size) return false;
+            binary_rx.bin_length = length;
+        }
+        rx_streaming = (!rx_discard && NULL != bin_stream_handler);
+        break;
+    case STRING_MESSAGE:
+        string_rx.str_id = msg_id;
+        if (!rx_discard) {
+            if (length > (STRING_BUFFER_SIZE - 1)) return false;
+            string_rx.str_length = length;
+            string_rx.buffer[length] = '\0';
+        }
+        break;
+    default:
+        return false;
+    }
+
+    rx_index = 0;
+    rx_length = length;
+    rx_state = (0 == rx_length) ? RX_COMPACT_CHECKSUM : RX_COMPACT_PAYLOAD;
+
+    return true;
+}
 
-    // read the string id
-    while (timeout > millis() && temp < 3) {
-        // check for delimiters
-        read_ret = serial_stream->peek();
-        if (-1 == read_ret) continue;
-        rx_char = (char) read_ret;
-        if (rx_char == ',') break;
+bool SerialComm::Store_Compact(const uint8_t * bytes, uint16_t num_bytes)
+{
+    BlockChecksum(bytes, num_bytes, &rx_check_a, &rx_check_b);
 
-        // add to the id buffer
-        if (GetNextChar(&rx_char)) id_buffer[temp++] = rx_char;
+    if (rx_discard) return true;
+
+    switch (rx_type) {
+    case ASCII_MESSAGE:
+        for (uint16_t i = 0; i < num_bytes; i++) {
+            if (',' != bytes[i]) continue;
+            if (ascii_rx.num_params < ASCII_PARAM_INDEX_SIZE) param_offsets[ascii_rx.num_params] = (uint8_t) (rx_index + i);
+            ascii_rx.num_params++;
+        }
+        memcpy(ascii_rx.buffer + rx_index, bytes, num_bytes);
+        break;
+    case ACK_MESSAGE:
+        if (bytes[0] > 1) return false;
+        ack_value = (1 == bytes[0]);
+        break;
+    case BIN_MESSAGE:
+        if (rx_compressed) {
+            return Decode_Bin(bytes, num_bytes);
+        } else if (NULL != bin_stream_handler) {
+            bin_stream_handler(binary_rx.bin_id, rx_index, bytes, num_bytes, bin_stream_context);
+        } else {
+            memcpy(binary_rx.bin_buffer + rx_index, bytes, num_bytes);
+        }
+        break;
+    case STRING_MESSAGE:
+        memcpy(string_rx.buffer + rx_index, bytes, num_bytes);
+        break;
+    default:
+        return false;
     }
 
-    // if timed out, flush the buffer and return error
-    if (timeout <= millis()) {
-        serial_stream->flush();
+    return true;
+}
+
+bool SerialComm::Decode_Bin(const uint8_t * bytes, uint16_t num_bytes)
+{
+    uint16_t decoded = binary_rx.bin_length;
+
+    if (!LZDecode(&rx_decoder, bytes, num_bytes, binary_rx.bin_buffer, binary_rx.buffer_size, &binary_rx.bin_length)) {
         return false;
     }
 
-    // if the next char isn't a comma, there's been an error
-    if (!ReadSpecificChar(timeout, ',')) return false;
+    // matches refer back to the decoded bytes, so they're kept in the buffer and streamed from there as they appear
+    if (NULL != bin_stream_handler && binary_rx.bin_length != decoded) {
+        bin_stream_handler(binary_rx.bin_id, decoded, binary_rx.bin_buffer + decoded, binary_rx.bin_length - decoded,
+                           bin_stream_context);
+    }
 
-    // convert the string id
-    if (1 != sscanf(id_buffer, "%u", &temp)) return false;
-    if (temp > 255) return false;
-    string_rx.str_id = (uint8_t) temp;
+    return true;
+}
 
-    // read the string length
-    temp = 0;
-    while (timeout > millis() && temp < 5) {
-        // check for delimiters
-        read_ret = serial_stream->peek();
-        if (-1 == read_ret) continue;
-        rx_char = (char) read_ret;
-        if (rx_char == ';') break;
+// -------------------- RX Field Helpers ------------------
 
-        // add to the length buffer
-        if (GetNextChar(&rx_char)) length_buffer[temp++] = rx_char;
+// returns the index of the first message delimiter, or length if there isn't one, with zeros only counted if compact
+static uint16_t FindDelimiter(const uint8_t * bytes, uint16_t length, bool compact_frames)
+{
+    uint16_t i = 0;
+
+#if defined(__SSE2__)
+    const __m128i ascii = _mm_set1_epi8(ASCII_DELIMITER);
+    const __m128i ack = _mm_set1_epi8(ACK_DELIMITER);
+    const __m128i bin = _mm_set1_epi8(BIN_DELIMITER);
+    const __m128i string = _mm_set1_epi8(STRING_DELIMITER);
+    const __m128i compressed = _mm_set1_epi8(COMPRESSED_BIN_DELIMITER);
+    const __m128i framing = _mm_set1_epi8(FRAMING_DELIMITER);
+    const __m128i compact = _mm_set1_epi8(compact_frames ? COMPACT_DELIMITER : ASCII_DELIMITER); // no new match if not
+    __m128i chunk;
+    int mask = 0;
+
+    for (; i + 16 <= length; i += 16) {
+        chunk = _mm_loadu_si128((const __m128i *) (bytes + i));
+        mask = _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, ascii), _mm_cmpeq_epi8(chunk, ack)),
+                                                           _mm_or_si128(_mm_cmpeq_epi8(chunk, bin), _mm_cmpeq_epi8(chunk, string))),
+                                              _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, framing), _mm_cmpeq_epi8(chunk, compact)),
+                                                           _mm_cmpeq_epi8(chunk, compressed))));
+        if (0 != mask) return i + __builtin_ctz(mask);
     }
+#endif
 
-    // if timed out, flush the buffer and return error
-    if (timeout <= millis()) {
-        serial_stream->flush();
-        return false;
+    for (; i < length; i++) {
+        switch (bytes[i]) {
+        case ASCII_DELIMITER:
+        case ACK_DELIMITER:
+        case BIN_DELIMITER:
+        case STRING_DELIMITER:
+        case COMPRESSED_BIN_DELIMITER:
+        case FRAMING_DELIMITER:
+            return i;
+        case COMPACT_DELIMITER:
+            if (compact_frames) return i;
+            break;
+        default:
+            break;
+        }
     }
 
-    // if the next char isn't a semicolon, there's been an error
-    if (!ReadSpecificChar(timeout, ';')) return false;
+    return length;
+}
+
+void SerialComm::DropFrame()
+{
+    discarded_bytes += rx_frame_bytes;
+    rx_state = RX_IDLE;
+    EndStream(STREAM_DROPPED);
+}
 
-    // convert the string length
-    if (1 != sscanf(length_buffer, "%u", &temp)) return false;
-    if (temp > 65534) return false;
-    string_rx.str_length = (uint16_t) temp;
+void SerialComm::EndStream(BinStreamResult_t result)
+{
+    if (!rx_streaming) return;
+    rx_streaming = false;
 
-    // read the string section
-    temp = 0;
-    while (timeout > millis() && temp < string_rx.str_length && temp < (STRING_BUFFER_SIZE-1)) {
-        if (GetNextChar(&rx_char)) string_rx.buffer[temp++] = (uint8_t) rx_char;
+    // compressed payloads are streamed as they're decoded, so the decoded length is what's been streamed
+    if (NULL != bin_stream_end_handler) {
+        bin_stream_end_handler(binary_rx.bin_id, rx_compressed ? binary_rx.bin_length : rx_index, result,
+                               bin_stream_context);
     }
+}
+
+void SerialComm::SkipToDelimiter()
+{
+    uint16_t start = rx_buffer_head;
+
+    // the newline that ends each message isn't noise
+    if ('\n' == rx_buffer[rx_buffer_head]) start++;
+
+    rx_buffer_head += FindDelimiter(rx_buffer + rx_buffer_head, rx_buffer_tail - rx_buffer_head,
+                                    FRAMING_COMPACT == framing || negotiate_framing);
+
+    if (rx_buffer_head > start) discarded_bytes += rx_buffer_head - start;
+}
+
+bool SerialComm::FillRXBuffer()
+{
+    int available = 0;
+
+    if (rx_buffer_head != rx_buffer_tail) return true;
+
+    available = serial_stream->available();
+    if (available <= 0) return false;
+
+    // only refilled once empty, so a single bulk read always starts at the beginning
+    if (available > RX_BUFFER_SIZE) available = RX_BUFFER_SIZE;
+    rx_buffer_head = 0;
+    rx_buffer_tail = serial_stream->readBytes(rx_buffer, available);
+
+    return rx_buffer_tail > 0;
+}
+
 
-    // if timed out, flush the buffer and return error
-    if (timeout <= millis()) {
-        serial_stream->flush();
+bool SerialComm::AddFieldChar(char rx_char, uint8_t max_chars)
+{
+    uint8_t digit = (uint8_t) (rx_char - '0');
+
+    // accumulate the value as the digits arrive
+    if (digit > 9 || rx_field_length >= max_chars) return false;
+
+    rx_field_value = rx_field_value * 10 + digit;
+    rx_field_length++;
+
+    return true;
+}
+
+bool SerialComm::ConvertField(uint16_t max_val, uint16_t * value)
+{
+    if (0 == rx_field_length || rx_field_value > max_val) return false;
+
+    *value = (uint16_t) rx_field_value;
+
+    return true;
+}
+
+inline void SerialComm::ResetField()
+{
+    rx_field_length = 0;
+    rx_field_value = 0;
+}
+
+// ----------------------- Dispatch -----------------------
+
+SerialMessage_t SerialComm::Dispatch()
+{
+    SerialMessage_t msg_type = RX();
+
+    if (NO_MESSAGE == msg_type || HandleMessage(msg_type)) return NO_MESSAGE;
+
+    return msg_type;
+}
+
+SerialMessage_t SerialComm::RXAll(uint16_t max_frames, uint32_t max_us)
+{
+    SerialMessage_t msg_type = NO_MESSAGE;
+    uint32_t start = micros();
+
+    for (uint16_t num_frames = 0; 0 == max_frames || num_frames < max_frames; num_frames++) {
+        if (0 != max_us && (micros() - start) >= max_us) break;
+
+        // RX() only returns NO_MESSAGE once the available input is used up
+        msg_type = RX();
+        if (NO_MESSAGE == msg_type) break;
+
+        // stop at a message without a handler so it isn't overwritten before the caller sees it
+        if (!HandleMessage(msg_type)) return msg_type;
+    }
+
+    return NO_MESSAGE;
+}
+
+bool SerialComm::HandleMessage(SerialMessage_t msg_type)
+{
+    uint8_t msg_id = 0;
+    HANDLER_ENTRY_t * entry = NULL;
+
+    switch (msg_type) {
+    case ASCII_MESSAGE:
+        msg_id = ascii_rx.msg_id;
+        break;
+    case ACK_MESSAGE:
+        msg_id = ack_id;
+        break;
+    case BIN_MESSAGE:
+        msg_id = binary_rx.bin_id;
+        break;
+    case STRING_MESSAGE:
+        msg_id = string_rx.str_id;
+        break;
+    case LARGE_BIN_MESSAGE:
+        msg_id = large_binary_rx.bin_id;
+        break;
+    case NO_MESSAGE:
+    default:
         return false;
     }
 
-    // null-terminate the buffer
-    string_rx.buffer[temp] = '\0';
+    entry = FindHandler(msg_type, msg_id);
+    if (NULL == entry) return false;
 
-    // the message should end with a semi-colon before the checksum
-    if (!ReadSpecificChar(timeout, ';')) return false;
+    entry->handler(this, msg_id, entry->context);
+
+    return true;
+}
+
+bool SerialComm::RegisterHandler(SerialMessage_t msg_type, uint8_t msg_id, MessageHandler_t handler, void * context)
+{
+    HANDLER_ENTRY_t * entry = NULL;
+    HANDLER_ENTRY_t * slot = NULL;
+
+    if (NO_MESSAGE == msg_type || NULL == handler) return false;
+
+    // replace the existing handler for the message if there is one
+    entry = FindHandler(msg_type, msg_id);
+
+    // otherwise take the first free slot in the probe sequence, which lookups will reach first
+    for (uint8_t probe = 0; NULL == entry && probe < HANDLER_TABLE_SIZE; probe++) {
+        slot = &handlers[(HandlerHash(msg_type, msg_id) + probe) & (HANDLER_TABLE_SIZE - 1)];
+        if (NULL == slot->handler) entry = slot;
+    }
+
+    if (NULL == entry) return false; // table is full
 
-    string_rx.checksum_valid = ReadChecksum(timeout);
+    if (NULL == entry->handler && HANDLER_UNUSED != entry->key) handler_tombstones--;
+    entry->key = ((uint16_t) msg_type << 8) | msg_id;
+    entry->handler = handler;
+    entry->context = context;
 
     return true;
 }
 
+void SerialComm::UnregisterHandler(SerialMessage_t msg_type, uint8_t msg_id)
+{
+    HANDLER_ENTRY_t * entry = FindHandler(msg_type, msg_id);
+
+    if (NULL == entry) return;
+
+    // the key is kept so that the probe sequence isn't broken, until there are enough of them to slow down misses
+    entry->handler = NULL;
+    entry->context = NULL;
+    if (++handler_tombstones >= HANDLER_TOMBSTONES) RebuildHandlers();
+}
+
+void SerialComm::RebuildHandlers()
+{
+    HANDLER_ENTRY_t * slot = NULL;
+    uint8_t hash = 0;
+    bool moved = true;
+
+    for (uint8_t i = 0; i < HANDLER_TABLE_SIZE; i++) {
+        if (NULL == handlers[i].handler) handlers[i].key = HANDLER_UNUSED;
+    }
+    handler_tombstones = 0;
+
+    // freeing the tombstones leaves gaps in probe sequences, so move each handler to the first free slot in its
+    // sequence until none can move (each move is to an earlier slot in the sequence, so this ends)
+    while (moved) {
+        moved = false;
+
+        for (uint8_t i = 0; i < HANDLER_TABLE_SIZE; i++) {
+            if (NULL == handlers[i].handler) continue;
+
+            hash = HandlerHash((SerialMessage_t) (handlers[i].key >> 8), (uint8_t) handlers[i].key);
+            for (uint8_t probe = 0; ((hash + probe) & (HANDLER_TABLE_SIZE - 1)) != i; probe++) {
+                slot = &handlers[(hash + probe) & (HANDLER_TABLE_SIZE - 1)];
+                if (HANDLER_UNUSED != slot->key) continue;
+
+                *slot = handlers[i];
+                handlers[i].key = HANDLER_UNUSED;
+                handlers[i].handler = NULL;
+                handlers[i].context = NULL;
+                moved = true;
+                break;
+            }
+        }
+    }
+}
+
+void SerialComm::DropUnhandled(bool drop)
+{
+    drop_unhandled = drop;
+}
+
+HANDLER_ENTRY_t * SerialComm::FindHandler(SerialMessage_t msg_type, uint8_t msg_id)
+{
+    uint16_t key = ((uint16_t) msg_type << 8) | msg_id;
+    HANDLER_ENTRY_t * entry = NULL;
+
+    for (uint8_t probe = 0; probe < HANDLER_TABLE_SIZE; probe++) {
+        entry = &handlers[(HandlerHash(msg_type, msg_id) + probe) & (HANDLER_TABLE_SIZE - 1)];
+
+        if (HANDLER_UNUSED == entry->key) return NULL;
+        if (key == entry->key && NULL != entry->handler) return entry;
+    }
+
+    return NULL;
+}
+
+inline uint8_t SerialComm::HandlerHash(SerialMessage_t msg_type, uint8_t msg_id)
+{
+    return (uint8_t) (msg_id + 37 * (uint8_t) msg_type);
+}
+
 // -------------------------- TX --------------------------
 
 void SerialComm::TX_ASCII()
@@ -416,6 +1095,14 @@ void SerialComm::TX_ASCII()
 
 void SerialComm::TX_ASCII(uint8_t msg_id)
 {
+    BIN_SEGMENT_t params = {(const uint8_t *) ascii_tx.buffer, ascii_tx.buffer_index};
+
+    if (FRAMING_COMPACT == framing) {
+        TX_Compact(ASCII_DELIMITER, msg_id, &params, 1);
+        ResetTX();
+        return;
+    }
+
     ResetChecksum();
     WriteChar(ASCII_DELIMITER);
     WriteASCIIu8(msg_id);
@@ -424,12 +1111,20 @@ void SerialComm::TX_ASCII(uint8_t msg_id)
     }
     WriteChar(';');
     WriteChecksum();
-    serial_stream->print('\n');
+    EndFrame();
     ResetTX();
 }
 
 void SerialComm::TX_Ack(uint8_t msg_id, bool ack_val)
 {
+    uint8_t value = ack_val ? 1 : 0;
+    BIN_SEGMENT_t segment = {&value, 1};
+
+    if (FRAMING_COMPACT == framing) {
+        TX_Compact(ACK_DELIMITER, msg_id, &segment, 1);
+        return;
+    }
+
     ResetChecksum();
     WriteChar(ACK_DELIMITER);
     WriteASCIIu8(msg_id);
@@ -437,7 +1132,7 @@ void SerialComm::TX_Ack(uint8_t msg_id, bool ack_val)
     ack_val ? WriteChar('1') : WriteChar('0');
     WriteChar(';');
     WriteChecksum();
-    serial_stream->print('\n');
+    EndFrame();
 }
 
 bool SerialComm::TX_Bin()
@@ -447,20 +1142,120 @@ bool SerialComm::TX_Bin()
 
 bool SerialComm::TX_Bin(uint8_t bin_id)
 {
+    BIN_SEGMENT_t segment = {binary_tx.bin_buffer, binary_tx.bin_length};
+
     if (binary_tx.bin_buffer == NULL) return false;
 
+    return TX_Bin(bin_id, &segment, 1);
+}
+
+bool SerialComm::TX_Bin(uint8_t bin_id, const BIN_SEGMENT_t * segments, uint8_t num_segments)
+{
+    BIN_SEGMENT_t compressed = {compress_buffer, 0};
+    char type = BIN_DELIMITER;
+    uint32_t length = 0;
+
+    if (NULL == segments) return false;
+
+    for (uint8_t i = 0; i < num_segments; i++) {
+        if (NULL == segments[i].buffer && 0 != segments[i].length) return false;
+        length += segments[i].length;
+    }
+
+    // the segments are sent as a single message
+    if (length > 65535) return false;
+
+    // send the compressed payload instead if it's smaller, and the peer has said it can decompress it
+    if (NULL != compress_buffer && peer_decompress
+        && Compress_Bin(segments, num_segments, (uint16_t) length, &compressed.length)) {
+        type = COMPRESSED_BIN_DELIMITER;
+        segments = &compressed;
+        num_segments = 1;
+        length = compressed.length;
+    }
+
+    if (FRAMING_COMPACT == framing) {
+        TX_Compact(type, bin_id, segments, num_segments);
+        return true;
+    }
+
     ResetChecksum();
-    WriteChar(BIN_DELIMITER);
+    WriteChar(type);
     WriteASCIIu8(bin_id);
     WriteChar(',');
-    WriteASCIIu16(binary_tx.bin_length);
+    WriteASCIIu16((uint16_t) length);
     WriteChar(';');
-    for (int i = 0; i < binary_tx.bin_length; i++) {
-        WriteBinByte(binary_tx.bin_buffer[i]);
+    for (uint8_t i = 0; i < num_segments; i++) {
+        WriteBinBuffer(segments[i].buffer, segments[i].length);
     }
     WriteChar(';');
     WriteChecksum();
-    serial_stream->print('\n');
+    EndFrame();
+
+    return true;
+}
+
+bool SerialComm::Compress_Bin(const BIN_SEGMENT_t * segments, uint8_t num_segments, uint16_t length, uint16_t * compressed_length)
+{
+    // stop as soon as the compressed payload is no smaller than the original
+    uint16_t limit = (length - 1 < compress_buffer_size) ? length - 1 : compress_buffer_size;
+    uint16_t used = 0;
+    uint16_t segment_length = 0;
+
+    if (0 == length) return false;
+
+    // each segment is compressed on its own, the decoder's output is contiguous either way
+    for (uint8_t i = 0; i < num_segments; i++) {
+        if (0 == segments[i].length) continue;
+
+        segment_length = LZCompress(segments[i].buffer, segments[i].length, compress_buffer + used, limit - used);
+        if (0 == segment_length) return false;
+
+        used += segment_length;
+    }
+
+    *compressed_length = used;
+
+    return true;
+}
+
+bool SerialComm::TX_Large_Bin(uint8_t bin_id, const uint8_t * buffer, uint32_t length)
+{
+    uint8_t check_object_a = 0;
+    uint8_t check_object_b = 0;
+    uint32_t offset = 0;
+    uint16_t num_bytes = 0;
+    uint8_t header[LARGE_BIN_HEADER_SIZE];
+    BIN_SEGMENT_t segments[2] = {{header, LARGE_BIN_HEADER_SIZE}, {NULL, 0}};
+
+    if (NULL == buffer && 0 != length) return false;
+
+    BlockChecksum(buffer, length, &check_object_a, &check_object_b);
+
+    // fragment header: total length, offset, and object checksum (big endian)
+    header[0] = (length >> 24) & 0xFF;
+    header[1] = (length >> 16) & 0xFF;
+    header[2] = (length >> 8) & 0xFF;
+    header[3] = length & 0xFF;
+    header[8] = check_object_a;
+    header[9] = check_object_b;
+
+    // send at least one fragment so that empty objects are still delivered
+    do {
+        num_bytes = (length - offset > LARGE_BIN_FRAGMENT_SIZE) ? LARGE_BIN_FRAGMENT_SIZE : (uint16_t) (length - offset);
+
+        header[4] = (offset >> 24) & 0xFF;
+        header[5] = (offset >> 16) & 0xFF;
+        header[6] = (offset >> 8) & 0xFF;
+        header[7] = offset & 0xFF;
+
+        segments[1].buffer = buffer + offset;
+        segments[1].length = num_bytes;
+
+        TX_Bin(bin_id, segments, 2);
+
+        offset += num_bytes;
+    } while (offset < length);
 
     return true;
 }
@@ -476,6 +1271,12 @@ void SerialComm::TX_String(uint8_t str_id, const char * msg)
 
     string_tx.str_length = length;
 
+    if (FRAMING_COMPACT == framing) {
+        BIN_SEGMENT_t segment = {(const uint8_t *) string_tx.buffer, length};
+        TX_Compact(STRING_DELIMITER, str_id, &segment, 1);
+        return;
+    }
+
     ResetChecksum();
     WriteChar(STRING_DELIMITER);
     WriteASCIIu8(str_id);
@@ -487,7 +1288,44 @@ void SerialComm::TX_String(uint8_t str_id, const char * msg)
     }
     WriteChar(';');
     WriteChecksum();
-    serial_stream->print('\n');
+    EndFrame();
+}
+
+void SerialComm::SetFraming(Framing_t framing_in)
+{
+    framing = framing_in;
+    negotiate_framing = false;
+}
+
+Framing_t SerialComm::GetFraming()
+{
+    return framing;
+}
+
+void SerialComm::NegotiateFraming()
+{
+    negotiate_framing = true;
+    AnnounceCapabilities();
+}
+
+void SerialComm::AnnounceCapabilities()
+{
+    // only a receiver with an RX buffer can decompress, since matches refer back to the decoded bytes
+    uint8_t version = negotiate_framing ? COMPACT_VERSION : TEXT_VERSION;
+    if (NULL != binary_rx.bin_buffer) version |= CAN_DECOMPRESS;
+
+    // always sent as text, peers without compact framing don't recognize the delimiter and ignore it
+    ResetChecksum();
+    WriteChar(FRAMING_DELIMITER);
+    WriteASCIIu8(version);
+    WriteChar(';');
+    WriteChecksum();
+    EndFrame();
+}
+
+bool SerialComm::PeerCanDecompress()
+{
+    return peer_decompress;
 }
 
 // ---------------- RX String Interface -------------------
@@ -509,38 +1347,193 @@ bool SerialComm::Get_string(char * buffer, uint16_t buffer_size)
     return true;
 }
 
+// ------------------ Decimal Formatting ------------------
+
+// two digits at a time, so formatting needs half as many divisions
+static const char digit_pairs[201] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static const uint32_t powers_of_ten[10] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
+
+static uint8_t CountDigits(uint32_t value)
+{
+    uint8_t num_digits = 1;
+
+    while (num_digits < 10 && value >= powers_of_ten[num_digits]) num_digits++;
+
+    return num_digits;
+}
+
+// writes exactly num_digits chars (no null terminator) from the least significant digit backwards
+static void FormatDecimal(uint32_t value, char * buffer, uint8_t num_digits)
+{
+    uint32_t pair = 0;
+    char * end = buffer + num_digits;
+
+    while (value >= 100) {
+        pair = value % 100;
+        value /= 100;
+        *--end = digit_pairs[2 * pair + 1];
+        *--end = digit_pairs[2 * pair];
+    }
+
+    if (value >= 10) {
+        *--end = digit_pairs[2 * value + 1];
+        *--end = digit_pairs[2 * value];
+    } else {
+        *--end = (char) ('0' + value);
+    }
+}
+
 // --------------------- TX Helpers -----------------------
 
 inline void SerialComm::WriteBinByte(uint8_t new_byte)
 {
-    serial_stream->write(new_byte);
+    // send what's buffered so far if the frame doesn't fit
+    if (tx_frame_length >= TX_FRAME_SIZE) SendFrame();
+
+    tx_frame[tx_frame_length++] = new_byte;
     UpdateChecksum(new_byte);
 }
 
 inline void SerialComm::WriteChar(char new_char)
 {
-    serial_stream->print(new_char);
-    UpdateChecksum((uint8_t) new_char);
+    WriteBinByte((uint8_t) new_char);
 }
 
-void SerialComm::WriteASCIIu8(uint8_t new_u8)
+void SerialComm::WriteBinBuffer(const uint8_t * buffer, uint16_t length)
 {
-    char ubuffer[4] = {0};
-    int num = snprintf(ubuffer, 4, "%u", new_u8);
+    BlockChecksum(buffer, length, &check_a, &check_b);
 
-    if (num < 1 || num > 3) return;
+    // small buffers are copied into the frame, large ones are written straight from the source buffer
+    if (length <= TX_FRAME_SIZE - tx_frame_length) {
+        memcpy(tx_frame + tx_frame_length, buffer, length);
+        tx_frame_length += length;
+    } else {
+        SendFrame();
+        serial_stream->write(buffer, length);
+    }
+}
 
-    for (int i = 0; i < num; i++) {
-        WriteChar(ubuffer[i]);
+void SerialComm::EndFrame()
+{
+    // the trailing newline isn't part of the checksum
+    if (tx_frame_length >= TX_FRAME_SIZE) SendFrame();
+    tx_frame[tx_frame_length++] = '\n';
+
+    SendFrame();
+}
+
+void SerialComm::SendFrame()
+{
+    if (0 == tx_frame_length) return;
+
+    serial_stream->write(tx_frame, tx_frame_length);
+    tx_frame_length = 0;
+}
+
+// ------------------ Compact TX Helpers ------------------
+
+void SerialComm::TX_Compact(char type, uint8_t msg_id, const BIN_SEGMENT_t * segments, uint8_t num_segments)
+{
+    uint16_t length = 0;
+    uint8_t header[COMPACT_HEADER_SIZE];
+    uint8_t checksum[2];
+
+    for (uint8_t i = 0; i < num_segments; i++) {
+        length += segments[i].length;
+    }
+
+    header[0] = (uint8_t) type;
+    header[1] = msg_id;
+    header[2] = (length >> 8) & 0xFF;
+    header[3] = length & 0xFF;
+
+    ResetChecksum();
+    tx_frame[tx_frame_length++] = COMPACT_DELIMITER;
+    StartCOBSBlock();
+
+    WriteCompact(header, COMPACT_HEADER_SIZE);
+    for (uint8_t i = 0; i < num_segments; i++) {
+        WriteCompact(segments[i].buffer, segments[i].length);
+    }
+
+    // the checksum isn't part of itself
+    checksum[0] = check_a;
+    checksum[1] = check_b;
+    EncodeCOBS(checksum, 2);
+
+    // close the last block and end the frame
+    tx_frame[tx_cobs_code] = tx_cobs_run + 1;
+    if (tx_frame_length >= TX_FRAME_SIZE) SendFrame();
+    tx_frame[tx_frame_length++] = COMPACT_DELIMITER;
+
+    SendFrame();
+}
+
+void SerialComm::WriteCompact(const uint8_t * buffer, uint16_t length)
+{
+    BlockChecksum(buffer, length, &check_a, &check_b);
+    EncodeCOBS(buffer, length);
+}
+
+void SerialComm::StartCOBSBlock()
+{
+    // a block's code byte isn't known until it ends, so the whole block must fit in the frame buffer
+    if (TX_FRAME_SIZE - tx_frame_length < COBS_BLOCK_SIZE + 1) SendFrame();
+
+    tx_cobs_code = tx_frame_length++;
+    tx_cobs_run = 0;
+}
+
+void SerialComm::EncodeCOBS(const uint8_t * buffer, uint16_t length)
+{
+    const uint8_t * zero = NULL;
+    uint16_t run = 0;
+
+    while (length > 0) {
+        // copy up to the next zero or the end of the block
+        run = COBS_BLOCK_SIZE - tx_cobs_run;
+        if (run > length) run = length;
+        zero = (const uint8_t *) memchr(buffer, 0, run);
+        if (NULL != zero) run = zero - buffer;
+
+        memcpy(tx_frame + tx_frame_length, buffer, run);
+        tx_frame_length += run;
+        tx_cobs_run += run;
+        buffer += run;
+        length -= run;
+
+        if (NULL != zero) {
+            // the zero is replaced by the block's code byte
+            tx_frame[tx_cobs_code] = tx_cobs_run + 1;
+            StartCOBSBlock();
+            buffer++;
+            length--;
+        } else if (COBS_BLOCK_SIZE == tx_cobs_run) {
+            tx_frame[tx_cobs_code] = 0xFF;
+            StartCOBSBlock();
+        }
     }
 }
 
+void SerialComm::WriteASCIIu8(uint8_t new_u8)
+{
+    WriteASCIIu16((uint16_t) new_u8);
+}
+
 void SerialComm::WriteASCIIu16(uint16_t new_u16)
 {
-    char ubuffer[6] = {0};
-    int num = snprintf(ubuffer, 6, "%u", new_u16);
+    char ubuffer[5];
+    uint8_t num = CountDigits(new_u16);
 
-    if (num < 1 || num > 5) return;
+    FormatDecimal(new_u16, ubuffer, num);
 
     for (int i = 0; i < num; i++) {
         WriteChar(ubuffer[i]);
@@ -561,34 +1554,132 @@ inline void SerialComm::ResetChecksum()
     check_b = 0;
 }
 
-bool SerialComm::ReadChecksum(uint32_t timeout)
+inline void SerialComm::UpdateRXChecksum(uint8_t new_byte)
 {
-    unsigned int temp = 0;
-    int read_ret = -1;
-    char rx_char = '\0';
-    char checksum_buffer[6] = "";
-    uint16_t checksum = 0;
+    rx_check_a = rx_check_a + new_byte;
+    rx_check_b = rx_check_b + rx_check_a;
+}
+
+inline void SerialComm::ResetRXChecksum()
+{
+    rx_check_a = 0;
+    rx_check_b = 0;
+}
+
+#if defined(__SSE2__)
+static inline uint32_t HorizontalSum(__m128i v)
+{
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return (uint32_t) _mm_cvtsi128_si32(v);
+}
+#elif defined(__ARM_NEON)
+static inline uint32_t HorizontalSum(uint32x4_t v)
+{
+    uint32x2_t pairs = vadd_u32(vget_low_u32(v), vget_high_u32(v));
+    return vget_lane_u32(vpadd_u32(pairs, pairs), 0);
+}
+#endif
+
+// Over a block of n bytes the checksum has a closed form: a += sum(x[i]) and b += n*a + sum((n-i)*x[i]).
+// The sums are independent of each other, so blocks can be unrolled or vectorized. Accumulating in 32 bits
+// is safe since the checksum bytes only need the sums modulo 256.
+void SerialComm::BlockChecksum(const uint8_t * buffer, uint32_t length, uint8_t * check_a, uint8_t * check_b)
+{
+    uint32_t a = *check_a;
+    uint32_t b = *check_b;
+    uint32_t i = 0;
+
+#if defined(__SSE2__)
+    if (length >= 16) {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i weights_lo = _mm_setr_epi16(16, 15, 14, 13, 12, 11, 10, 9);
+        const __m128i weights_hi = _mm_setr_epi16(8, 7, 6, 5, 4, 3, 2, 1);
+        __m128i sums = zero;     // running sum(x[i])
+        __m128i prefix = zero;   // sum of the running sums before each block, for the 16*a term
+        __m128i weighted = zero; // sum((16-i)*x[i]) within each block
+        __m128i bytes;
+        uint32_t num_blocks = length / 16;
+
+        for (; i + 16 <= length; i += 16) {
+            bytes = _mm_loadu_si128((const __m128i *) (buffer + i));
+            prefix = _mm_add_epi32(prefix, sums);
+            sums = _mm_add_epi32(sums, _mm_sad_epu8(bytes, zero));
+            weighted = _mm_add_epi32(weighted, _mm_madd_epi16(_mm_unpacklo_epi8(bytes, zero), weights_lo));
+            weighted = _mm_add_epi32(weighted, _mm_madd_epi16(_mm_unpackhi_epi8(bytes, zero), weights_hi));
+        }
+
+        b += 16 * num_blocks * a + 16 * HorizontalSum(prefix) + HorizontalSum(weighted);
+        a += HorizontalSum(sums);
+    }
+#elif defined(__ARM_NEON)
+    if (length >= 16) {
+        static const uint8_t weights[16] = {16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1};
+        const uint8x8_t weights_lo = vld1_u8(weights);
+        const uint8x8_t weights_hi = vld1_u8(weights + 8);
+        uint32x4_t sums = vdupq_n_u32(0);     // running sum(x[i])
+        uint32x4_t prefix = vdupq_n_u32(0);   // sum of the running sums before each block, for the 16*a term
+        uint32x4_t weighted = vdupq_n_u32(0); // sum((16-i)*x[i]) within each block
+        uint8x16_t bytes;
+        uint32_t num_blocks = length / 16;
+
+        for (; i + 16 <= length; i += 16) {
+            bytes = vld1q_u8(buffer + i);
+            prefix = vaddq_u32(prefix, sums);
+            sums = vpadalq_u16(sums, vpaddlq_u8(bytes));
+            weighted = vpadalq_u16(weighted, vmull_u8(vget_low_u8(bytes), weights_lo));
+            weighted = vpadalq_u16(weighted, vmull_u8(vget_high_u8(bytes), weights_hi));
+        }
+
+        b += 16 * num_blocks * a + 16 * HorizontalSum(prefix) + HorizontalSum(weighted);
+        a += HorizontalSum(sums);
+    }
+#elif defined(__ARM_FEATURE_DSP) && defined(__ARM_FEATURE_SIMD32)
+    // Cortex-M4/M7: a word at a time, summing its bytes with usada8 and weighting them with smlad on the
+    // even (x[0], x[2]) and odd (x[1], x[3]) bytes unpacked into halfwords
+    if (length >= 4) {
+        uint32_t sums = 0;     // running sum(x[i])
+        uint32_t prefix = 0;   // sum of the running sums before each word, for the 4*a term
+        int32_t weighted = 0;  // sum((4-i)*x[i]) within each word
+        uint32_t word = 0;
+        uint32_t num_words = length / 4;
+
+        for (; i + 4 <= length; i += 4) {
+            memcpy(&word, buffer + i, 4); // unaligned loads are fine on the M4/M7
+            prefix += sums;
+            sums = __usada8(word, 0, sums);
+            weighted = __smlad((int32_t) __uxtb16(word), 0x00020004, weighted);
+            weighted = __smlad((int32_t) __uxtb16(__ror(word, 8)), 0x00010003, weighted);
+        }
 
-    // read the binary length
-    while (timeout > millis() && temp < 5) {
-        // check for delimiters
-        read_ret = serial_stream->peek();
-        if (-1 == read_ret) continue;
-        rx_char = (char) read_ret;
-        if (rx_char == ';') break;
+        b += 4 * num_words * a + 4 * prefix + (uint32_t) weighted;
+        a += sums;
+    }
+#endif
+
+    // unrolled scalar blocks of four
+    for (; i + 4 <= length; i += 4) {
+        b += 4 * a + 4 * buffer[i] + 3 * buffer[i + 1] + 2 * buffer[i + 2] + buffer[i + 3];
+        a += buffer[i] + buffer[i + 1] + buffer[i + 2] + buffer[i + 3];
+    }
 
-        rx_char = serial_stream->read();
-        checksum_buffer[temp++] = rx_char;
+    for (; i < length; i++) {
+        a += buffer[i];
+        b += a;
     }
 
-    if (';' != serial_stream->read()) return false;
+    *check_a = (uint8_t) a;
+    *check_b = (uint8_t) b;
+}
+
+bool SerialComm::CheckChecksum()
+{
+    uint16_t checksum = 0;
 
     // convert the checksum
-    if (1 != sscanf(checksum_buffer, "%u", &temp)) return false;
-    if (temp > 65535) return false;
-    checksum = (uint16_t) temp;
+    if (!ConvertField(65535, &checksum)) return false;
 
-    return (checksum == (((uint16_t) check_a << 8) | (uint16_t) check_b));
+    return (checksum == (((uint16_t) rx_check_a << 8) | (uint16_t) rx_check_b));
 }
 
 void SerialComm::WriteChecksum()
@@ -604,26 +1695,10 @@ void SerialComm::WriteChecksum()
 
 bool SerialComm::Get_uint8(uint8_t * ret_val)
 {
-    char int_buffer[4] = {0};
-    uint8_t max_index = ascii_rx.buffer_index + 3; // uint8_t means 3 chars max
-    unsigned int temp = 0;
+    uint32_t temp = 0;
+    bool negative = false;
 
-    if (',' != ascii_rx.buffer[ascii_rx.buffer_index++]) return false; // always a leading comma
-
-    while (ascii_rx.buffer_index <= max_index) {
-        if (',' == ascii_rx.buffer[ascii_rx.buffer_index] || '\0' == ascii_rx.buffer[ascii_rx.buffer_index]) {
-            break;
-        }
-
-        int_buffer[temp++] = ascii_rx.buffer[ascii_rx.buffer_index++];
-    }
-
-    // ensure next char is ',' or '\0'
-    if (',' != ascii_rx.buffer[ascii_rx.buffer_index] && '\0' != ascii_rx.buffer[ascii_rx.buffer_index]) return false;
-
-    // convert the message id
-    if (1 != sscanf(int_buffer, "%u", &temp)) return false;
-    if (temp > 255) return false;
+    if (!Get_integer(255, 0, &temp, &negative)) return false;
     *ret_val = (uint8_t) temp;
 
     return true;
@@ -631,62 +1706,67 @@ bool SerialComm::Get_uint8(uint8_t * ret_val)
 
 bool SerialComm::Get_uint16(uint16_t * ret_val)
 {
-    char int_buffer[6] = {0};
-    uint8_t max_index = ascii_rx.buffer_index + 5; // uint16_t means 5 chars max
-    unsigned int temp = 0;
+    uint32_t temp = 0;
+    bool negative = false;
 
-    if (',' != ascii_rx.buffer[ascii_rx.buffer_index++]) return false; // always a leading comma
+    if (!Get_integer(65535, 0, &temp, &negative)) return false;
+    *ret_val = (uint16_t) temp;
 
-    while (ascii_rx.buffer_index <= max_index) {
-        if (',' == ascii_rx.buffer[ascii_rx.buffer_index] || '\0' == ascii_rx.buffer[ascii_rx.buffer_index]) {
-            break;
-        }
+    return true;
+}
 
-        int_buffer[temp++] = ascii_rx.buffer[ascii_rx.buffer_index++];
-    }
+bool SerialComm::Get_uint32(uint32_t * ret_val)
+{
+    uint32_t temp = 0;
+    bool negative = false;
 
-    // ensure next char is ',' or '\0'
-    if (',' != ascii_rx.buffer[ascii_rx.buffer_index] && '\0' != ascii_rx.buffer[ascii_rx.buffer_index]) return false;
+    if (!Get_integer(4294967295UL, 0, &temp, &negative)) return false;
+    *ret_val = temp;
 
-    // convert the message id
-    if (1 != sscanf(int_buffer, "%u", &temp)) return false;
-    if (temp > 65535) return false;
-    *ret_val = (uint16_t) temp;
+    return true;
+}
+
+bool SerialComm::Get_int8(int8_t * ret_val)
+{
+    uint32_t temp = 0;
+    bool negative = false;
+
+    if (!Get_integer(127, 128, &temp, &negative)) return false;
+    *ret_val = (int8_t) (negative ? -(int32_t) temp : (int32_t) temp);
 
     return true;
 }
 
-bool SerialComm::Get_uint32(uint32_t * ret_val)
+bool SerialComm::Get_int16(int16_t * ret_val)
 {
-    char int_buffer[11] = {0};
-    uint8_t max_index = ascii_rx.buffer_index + 10; // uint32_t means 10 chars max
-    unsigned int temp = 0;
+    uint32_t temp = 0;
+    bool negative = false;
 
-    if (',' != ascii_rx.buffer[ascii_rx.buffer_index++]) return false; // always a leading comma
+    if (!Get_integer(32767, 32768, &temp, &negative)) return false;
+    *ret_val = (int16_t) (negative ? -(int32_t) temp : (int32_t) temp);
 
-    while (ascii_rx.buffer_index <= max_index) {
-        if (',' == ascii_rx.buffer[ascii_rx.buffer_index] || '\0' == ascii_rx.buffer[ascii_rx.buffer_index]) {
-            break;
-        }
+    return true;
+}
 
-        int_buffer[temp++] = ascii_rx.buffer[ascii_rx.buffer_index++];
-    }
+bool SerialComm::Get_int32(int32_t * ret_val)
+{
+    uint32_t temp = 0;
+    bool negative = false;
 
-    // ensure next char is ',' or '\0'
-    if (',' != ascii_rx.buffer[ascii_rx.buffer_index] && '\0' != ascii_rx.buffer[ascii_rx.buffer_index]) return false;
+    if (!Get_integer(2147483647UL, 2147483648UL, &temp, &negative)) return false;
 
-    // convert the message id
-    if (1 != sscanf(int_buffer, "%u", &temp)) return false;
-    *ret_val = temp;
+    // negate as unsigned so that INT32_MIN doesn't overflow
+    *ret_val = (int32_t) (negative ? (uint32_t) 0 - temp : temp);
 
     return true;
 }
 
-bool SerialComm::Get_int8(int8_t * ret_val)
+bool SerialComm::Get_float(float * ret_val)
 {
-    char int_buffer[5] = {0};
-    uint8_t max_index = ascii_rx.buffer_index + 4; // int8_t means 4 chars max
-    int temp = 0;
+    char int_buffer[16] = {0};
+    uint8_t max_index = ascii_rx.buffer_index + 15; // 15 chars max
+    unsigned int temp = 0;
+    float temp_float = 0.0f;
 
     if (',' != ascii_rx.buffer[ascii_rx.buffer_index++]) return false; // always a leading comma
 
@@ -702,89 +1782,119 @@ bool SerialComm::Get_int8(int8_t * ret_val)
     if (',' != ascii_rx.buffer[ascii_rx.buffer_index] && '\0' != ascii_rx.buffer[ascii_rx.buffer_index]) return false;
 
     // convert the message id
-    if (1 != sscanf(int_buffer, "%d", &temp)) return false;
-    if (temp > 127 || temp < -128) return false;
-    *ret_val = (int8_t) temp;
+    if (1 != sscanf(int_buffer, "%f", &temp_float)) return false;
+    *ret_val = temp_float;
 
     return true;
 }
 
-bool SerialComm::Get_int16(int16_t * ret_val)
+bool SerialComm::Get_uint8(uint8_t param, uint8_t * ret_val)
 {
-    char int_buffer[7] = {0};
-    uint8_t max_index = ascii_rx.buffer_index + 6; // int16_t means 6 chars max
-    int temp = 0;
+    return Seek_Param(param) && Get_uint8(ret_val);
+}
 
-    if (',' != ascii_rx.buffer[ascii_rx.buffer_index++]) return false; // always a leading comma
+bool SerialComm::Get_uint16(uint8_t param, uint16_t * ret_val)
+{
+    return Seek_Param(param) && Get_uint16(ret_val);
+}
 
-    while (ascii_rx.buffer_index <= max_index) {
-        if (',' == ascii_rx.buffer[ascii_rx.buffer_index] || '\0' == ascii_rx.buffer[ascii_rx.buffer_index]) {
-            break;
-        }
+bool SerialComm::Get_uint32(uint8_t param, uint32_t * ret_val)
+{
+    return Seek_Param(param) && Get_uint32(ret_val);
+}
 
-        int_buffer[temp++] = ascii_rx.buffer[ascii_rx.buffer_index++];
-    }
+bool SerialComm::Get_int8(uint8_t param, int8_t * ret_val)
+{
+    return Seek_Param(param) && Get_int8(ret_val);
+}
 
-    // ensure next char is ',' or '\0'
-    if (',' != ascii_rx.buffer[ascii_rx.buffer_index] && '\0' != ascii_rx.buffer[ascii_rx.buffer_index]) return false;
+bool SerialComm::Get_int16(uint8_t param, int16_t * ret_val)
+{
+    return Seek_Param(param) && Get_int16(ret_val);
+}
 
-    // convert the message id
-    if (1 != sscanf(int_buffer, "%d", &temp)) return false;
-    if (temp > 32767 || temp < -32768) return false;
-    *ret_val = (int16_t) temp;
+bool SerialComm::Get_int32(uint8_t param, int32_t * ret_val)
+{
+    return Seek_Param(param) && Get_int32(ret_val);
+}
 
-    return true;
+bool SerialComm::Get_float(uint8_t param, float * ret_val)
+{
+    return Seek_Param(param) && Get_float(ret_val);
 }
 
-bool SerialComm::Get_int32(int32_t * ret_val)
+bool SerialComm::Get_floats(float * values, uint8_t num_values)
 {
-    char int_buffer[12] = {0};
-    uint8_t max_index = ascii_rx.buffer_index + 11; // int32_t means 11 chars max
-    int temp = 0;
+    if (NULL == values || num_values > ascii_rx.num_params) return false;
 
-    if (',' != ascii_rx.buffer[ascii_rx.buffer_index++]) return false; // always a leading comma
+    ascii_rx.buffer_index = 0;
 
-    while (ascii_rx.buffer_index <= max_index) {
-        if (',' == ascii_rx.buffer[ascii_rx.buffer_index] || '\0' == ascii_rx.buffer[ascii_rx.buffer_index]) {
-            break;
-        }
+    for (uint8_t i = 0; i < num_values; i++) {
+        if (!Get_float(&values[i])) return false;
+    }
 
-        int_buffer[temp++] = ascii_rx.buffer[ascii_rx.buffer_index++];
+    return true;
+}
+
+bool SerialComm::Seek_Param(uint8_t param)
+{
+    uint8_t index = 0;
+    uint8_t num_commas = ASCII_PARAM_INDEX_SIZE - 1;
+
+    if (param >= ascii_rx.num_params) return false;
+
+    if (param < ASCII_PARAM_INDEX_SIZE) {
+        ascii_rx.buffer_index = param_offsets[param];
+        return true;
     }
 
-    // ensure next char is ',' or '\0'
-    if (',' != ascii_rx.buffer[ascii_rx.buffer_index] && '\0' != ascii_rx.buffer[ascii_rx.buffer_index]) return false;
+    // past the end of the index, count commas from the last indexed parameter
+    index = param_offsets[ASCII_PARAM_INDEX_SIZE - 1];
+    while (num_commas < param) {
+        if (',' == ascii_rx.buffer[++index]) num_commas++;
+    }
 
-    // convert the message id
-    if (1 != sscanf(int_buffer, "%d", &temp)) return false;
-    *ret_val = temp;
+    ascii_rx.buffer_index = index;
 
     return true;
 }
 
-bool SerialComm::Get_float(float * ret_val)
+bool SerialComm::Get_integer(uint32_t max_positive, uint32_t max_negative, uint32_t * magnitude, bool * negative)
 {
-    char int_buffer[16] = {0};
-    uint8_t max_index = ascii_rx.buffer_index + 15; // 15 chars max
-    unsigned int temp = 0;
-    float temp_float = 0.0f;
-
-    if (',' != ascii_rx.buffer[ascii_rx.buffer_index++]) return false; // always a leading comma
+    uint8_t index = ascii_rx.buffer_index;
+    uint32_t limit = max_positive;
+    uint32_t value = 0;
+    uint8_t digit = 0;
+    uint8_t num_digits = 0;
+    bool is_negative = false;
+
+    if (',' != ascii_rx.buffer[index++]) return false; // always a leading comma
+
+    // a sign is only allowed for signed types
+    if (0 != max_negative && ('-' == ascii_rx.buffer[index] || '+' == ascii_rx.buffer[index])) {
+        is_negative = ('-' == ascii_rx.buffer[index++]);
+        if (is_negative) limit = max_negative;
+    }
 
-    while (ascii_rx.buffer_index <= max_index) {
-        if (',' == ascii_rx.buffer[ascii_rx.buffer_index] || '\0' == ascii_rx.buffer[ascii_rx.buffer_index]) {
-            break;
-        }
+    // convert directly out of the buffer, checking for overflow before each digit
+    while (index < ASCII_BUFFER_SIZE) {
+        digit = (uint8_t) (ascii_rx.buffer[index] - '0');
+        if (digit > 9) break;
+        if (value > (limit - digit) / 10) return false;
 
-        int_buffer[temp++] = ascii_rx.buffer[ascii_rx.buffer_index++];
+        value = value * 10 + digit;
+        num_digits++;
+        index++;
     }
 
-    // ensure next char is ',' or '\0'
-    if (',' != ascii_rx.buffer[ascii_rx.buffer_index] && '\0' != ascii_rx.buffer[ascii_rx.buffer_index]) return false;
+    // ensure there was a number and the next char is ',' or '\0'
+    if (0 == num_digits || index >= ASCII_BUFFER_SIZE) return false;
+    if (',' != ascii_rx.buffer[index] && '\0' != ascii_rx.buffer[index]) return false;
 
-    // convert the message id
-    if (1 != sscanf(int_buffer, "%f", &temp_float)) return false;
-    *ret_val = temp_float;
+    // only advance once the parameter has been successfully parsed
+    ascii_rx.buffer_index = index;
+    *magnitude = value;
+    *negative = is_negative;
 
     return true;
 }
@@ -803,22 +1913,7 @@ bool SerialComm::Add_uint16(uint16_t val)
 
 bool SerialComm::Add_uint32(uint32_t val)
 {
-    uint8_t buffer_remaining = ASCII_BUFFER_SIZE - ascii_tx.buffer_index;
-    int num_written = 0;
-
-    // snprintf will return the number of chars it could write, but won't write more than buffer_remaining
-    // note leading comma!
-    num_written = snprintf(ascii_tx.buffer + ascii_tx.buffer_index, buffer_remaining, ",%u", (unsigned int) val);
-
-    // make sure the write was valid and not too large
-    if (num_written < 1 || num_written >= buffer_remaining) {
-        ResetTX();
-        return false;
-    }
-
-    ascii_tx.buffer_index += num_written;
-
-    return true;
+    return Add_decimal(val, false);
 }
 
 bool SerialComm::Add_int8(int8_t val)
@@ -833,24 +1928,42 @@ bool SerialComm::Add_int16(int16_t val)
 
 bool SerialComm::Add_int32(int32_t val)
 {
-    uint8_t buffer_remaining = ASCII_BUFFER_SIZE - ascii_tx.buffer_index;
-    int num_written = 0;
+    // negate as unsigned so that INT32_MIN doesn't overflow
+    if (val < 0) return Add_decimal((uint32_t) 0 - (uint32_t) val, true);
 
-    // snprintf will return the number of chars it could write, but won't write more than buffer_remaining
-    // note leading comma!
-    num_written = snprintf(ascii_tx.buffer + ascii_tx.buffer_index, buffer_remaining, ",%d", (int) val);
+    return Add_decimal((uint32_t) val, false);
+}
 
-    // make sure the write was valid and not too large
-    if (num_written < 1 || num_written >= buffer_remaining) {
+bool SerialComm::Add_decimal(uint32_t magnitude, bool negative)
+{
+    uint8_t buffer_remaining = ASCII_BUFFER_SIZE - ascii_tx.buffer_index;
+    uint8_t num_chars = CountDigits(magnitude) + (negative ? 2 : 1); // note leading comma!
+
+    // make sure the write isn't too large, leaving room for the null terminator
+    if (num_chars >= buffer_remaining) {
         ResetTX();
         return false;
     }
 
-    ascii_tx.buffer_index += num_written;
+    Append_decimal(magnitude, negative);
 
     return true;
 }
 
+void SerialComm::Append_decimal(uint32_t magnitude, bool negative)
+{
+    uint8_t num_digits = CountDigits(magnitude);
+    uint8_t num_chars = num_digits + (negative ? 2 : 1); // note leading comma!
+    char * param = ascii_tx.buffer + ascii_tx.buffer_index;
+
+    *param++ = ',';
+    if (negative) *param++ = '-';
+    FormatDecimal(magnitude, param, num_digits);
+
+    ascii_tx.buffer_index += num_chars;
+    ascii_tx.buffer[ascii_tx.buffer_index] = '\0';
+}
+
 bool SerialComm::Add_float(float val)
 {
     uint8_t buffer_remaining = ASCII_BUFFER_SIZE - ascii_tx.buffer_index;
@@ -870,3 +1983,10 @@ bool SerialComm::Add_float(float val)
 
     return true;
 }
+
+void SerialComm::Append_float(float val)
+{
+    // nine significant digits round trip a float, and the exponent keeps it to 15 chars, which Get_float accepts
+    ascii_tx.buffer_index += snprintf(ascii_tx.buffer + ascii_tx.buffer_index, ASCII_BUFFER_SIZE - ascii_tx.buffer_index,
+                                      ",%.9g", (double) val);
+}
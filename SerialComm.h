@@ -14,26 +14,93 @@
 #define SERIALCOMM_H
 
 #include "Arduino.h"
+#include "Compress.h"
 #include <stdint.h>
 
 #define ASCII_DELIMITER    '#'
 #define ACK_DELIMITER      '?'
 #define BIN_DELIMITER      '!'
 #define STRING_DELIMITER   '"'
+#define COMPRESSED_BIN_DELIMITER '&' // binary message with an LZ compressed payload
+#define FRAMING_DELIMITER  '%' // framing and capability negotiation, always sent as text
+
+// compact (v3) frames: a zero byte, then COBS(type, id, length, payload, checksum), then a zero byte
+#define COMPACT_DELIMITER   0x00
+#define TEXT_VERSION        2
+#define COMPACT_VERSION     3
+#define CAN_DECOMPRESS      0x80 // set in the version of a framing message by a receiver of compressed messages
+#define COMPACT_HEADER_SIZE 4   // type (message delimiter char), id, length (uint16, big endian)
+#define COBS_BLOCK_SIZE     254 // max data bytes in one COBS block
 
 #define READ_TIMEOUT       100 // milliseconds
+#define BIN_READ_TIMEOUT   1000 // milliseconds, some binary messages take up to a second
+
+// large binary messages are sent as fragments with a header of total length, offset, and object checksum
+#define LARGE_BIN_FRAGMENT_SIZE 1024 // bytes of the object per fragment
+#define LARGE_BIN_HEADER_SIZE   10
+
+// maximum number of registered message handlers, must be a power of two
+#define HANDLER_TABLE_SIZE 32
+#define HANDLER_UNUSED     0xFFFF
+#define HANDLER_TOMBSTONES (HANDLER_TABLE_SIZE / 4) // unregistered slots that trigger a rebuild of the table
 
 #define ASCII_BUFFER_SIZE  128
+
+// offsets of the first received ASCII parameters are indexed for random access, later ones are found by scanning
+#define ASCII_PARAM_INDEX_SIZE 32
 #define STRING_BUFFER_SIZE 128
 
+// bytes are read from the stream in bulk into an RX buffer of this size and parsed from memory
+#define RX_BUFFER_SIZE     128
+
+// messages are assembled here and handed to the stream in one write, fits a full string message and a full COBS block
+#define TX_FRAME_SIZE      256
+
 enum SerialMessage_t {
     NO_MESSAGE,
     ASCII_MESSAGE,
     ACK_MESSAGE,
     BIN_MESSAGE,
-    STRING_MESSAGE
+    STRING_MESSAGE,
+    LARGE_BIN_MESSAGE,
+    FRAMING_MESSAGE // the peer accepted compact framing, which is now used for transmitted messages
+};
+
+// header format used for transmitted messages, received messages can use either
+enum Framing_t : uint8_t {
+    FRAMING_TEXT,   // ASCII headers and checksum, newline terminated
+    FRAMING_COMPACT // binary header and checksum, COBS encoded between zero bytes
 };
 
+// states of the incremental RX parser, which is preserved between calls to RX()
+enum RXState_t : uint8_t {
+    RX_IDLE,         // searching for a delimiter
+    RX_ID,           // reading the message id
+    RX_LENGTH,       // reading the binary/string length
+    RX_ASCII_PARAMS, // reading the ASCII parameters
+    RX_ACK_VALUE,    // reading the ACK/NAK value
+    RX_PAYLOAD,      // reading the binary/string payload
+    RX_PAYLOAD_END,  // expecting the semicolon before the checksum
+    RX_CHECKSUM,     // reading the checksum
+    RX_COMPACT_HEADER,   // decoding a compact frame's header
+    RX_COMPACT_PAYLOAD,  // decoding a compact frame's payload
+    RX_COMPACT_CHECKSUM, // decoding a compact frame's checksum
+    RX_COMPACT_END       // expecting the zero byte that ends a compact frame
+};
+
+// receives each slice of a streamed binary payload as it arrives, offset is the slice's position in the payload
+typedef void (*BinStreamHandler_t)(uint8_t bin_id, uint16_t offset, const uint8_t * bytes, uint16_t num_bytes, void * context);
+
+// how a streamed binary payload ended
+enum BinStreamResult_t : uint8_t {
+    STREAM_VALID,   // the whole payload arrived with a valid checksum
+    STREAM_INVALID, // the whole payload arrived, but the checksum doesn't match
+    STREAM_DROPPED  // the message was dropped part way through (timeout, malformed, or corrupt compressed data)
+};
+
+// called once at the end of every streamed payload, length is the number of bytes that were streamed
+typedef void (*BinStreamEndHandler_t)(uint8_t bin_id, uint16_t length, BinStreamResult_t result, void * context);
+
 struct ASCII_MSG_t {
     uint8_t msg_id;
     uint8_t num_params;
@@ -57,6 +124,35 @@ struct BIN_MSG_t {
     uint8_t * bin_buffer;
 };
 
+// one piece of a binary message sent from multiple buffers
+struct BIN_SEGMENT_t {
+    const uint8_t * buffer;
+    uint16_t length;
+};
+
+struct LARGE_BIN_MSG_t {
+    uint8_t bin_id;
+    uint32_t total_length;
+    uint32_t bytes_received;
+    uint32_t buffer_size;
+    uint16_t object_checksum;
+    bool checksum_valid;
+    uint8_t * buffer;
+};
+
+class SerialComm;
+
+// handles a received message by reading it from the SerialComm object
+typedef void (*MessageHandler_t)(SerialComm * serial, uint8_t msg_id, void * context);
+
+struct HANDLER_ENTRY_t {
+    uint16_t key; // message type and id
+    MessageHandler_t handler;
+    void * context;
+};
+
+template <uint8_t ID, typename... Params> class ASCIIMessage;
+
 class SerialComm {
 public:
     SerialComm(Stream * stream_in);
@@ -69,8 +165,50 @@ public:
     void AssignBinaryRXBuffer(uint8_t * buffer, uint16_t size);
     void AssignBinaryTXBuffer(uint8_t * buffer, uint16_t size, uint16_t num_bytes);
 
-    // Receive interface
+    // Reassemble fragmented binary messages with this id into a buffer of up to 32-bit size
+    void AssignLargeBinaryRXBuffer(uint8_t bin_id, uint8_t * buffer, uint32_t size);
+
+    // Stream binary payloads to a handler instead of the RX buffer (NULL handler to stop streaming). Compressed
+    // payloads are still decoded into the RX buffer, and streamed from there. The end handler, if any, is told
+    // how each streamed payload ended, including ones that are dropped and never returned by RX().
+    void AssignBinaryRXStream(BinStreamHandler_t handler, void * context);
+    void AssignBinaryRXStream(BinStreamHandler_t handler, BinStreamEndHandler_t end_handler, void * context);
+
+    // Compress binary messages into this buffer before sending them, each is sent compressed only if that makes
+    // it smaller and the peer has announced that it can decompress it (NULL buffer to stop compressing).
+    // Received compressed messages are always decompressed.
+    void AssignCompressionBuffer(uint8_t * buffer, uint16_t size);
+
+    // Receive interface (non-blocking, only consumes bytes that are already available)
     SerialMessage_t RX();
+    bool RXInProgress();
+
+    // Dispatch interface, calls the registered handler for a received message. Returns messages that have no
+    // handler so they can be handled conventionally (NO_MESSAGE otherwise). RX() never calls handlers, so an object
+    // with handlers registered, including those of the layers built on it (ReliableComm, ChannelComm), must be
+    // serviced with Dispatch() or RXAll() instead.
+    SerialMessage_t Dispatch();
+
+    // Dispatch every pending message, up to max_frames messages or max_us microseconds (zero for no limit). Stops
+    // early and returns a message that has no handler, otherwise returns NO_MESSAGE.
+    SerialMessage_t RXAll(uint16_t max_frames, uint32_t max_us);
+    bool RegisterHandler(SerialMessage_t msg_type, uint8_t msg_id, MessageHandler_t handler, void * context);
+    void UnregisterHandler(SerialMessage_t msg_type, uint8_t msg_id);
+    void DropUnhandled(bool drop); // skip storing ASCII, binary, and string messages without a handler
+
+    // Select the framing for transmitted messages, or offer compact framing to the peer. Offers from the peer are
+    // only accepted after NegotiateFraming(), which switches both ends to compact framing once both have offered it
+    // (RX() returns FRAMING_MESSAGE when it does). SetFraming() stops accepting offers. Compact frames are only
+    // received in compact framing or after NegotiateFraming(), a zero byte is noise otherwise.
+    void SetFraming(Framing_t framing_in);
+    Framing_t GetFraming();
+    void NegotiateFraming();
+
+    // Tell the peer which framing this object has offered and whether it can decompress binary messages (if it
+    // has a binary RX buffer), sent by NegotiateFraming(). It isn't sent automatically when the binary RX buffer
+    // is assigned or removed, so call it again after changing the buffer to keep the peer's view current
+    void AnnounceCapabilities();
+    bool PeerCanDecompress();
 
     // Transmit interface
     void TX_ASCII();
@@ -78,6 +216,8 @@ public:
     void TX_Ack(uint8_t msg_id, bool ack_val);
     bool TX_Bin();
     bool TX_Bin(uint8_t bin_id);
+    bool TX_Bin(uint8_t bin_id, const BIN_SEGMENT_t * segments, uint8_t num_segments);
+    bool TX_Large_Bin(uint8_t bin_id, const uint8_t * buffer, uint32_t length);
     void TX_String(uint8_t str_id, const char * msg);
 
     // ASCII RX buffer interface
@@ -89,6 +229,18 @@ public:
     bool Get_int32(int32_t * ret_val);
     bool Get_float(float * ret_val);
 
+    // ASCII RX buffer random access by parameter number (from zero), leaves the buffer positioned after the parameter
+    bool Get_uint8(uint8_t param, uint8_t * ret_val);
+    bool Get_uint16(uint8_t param, uint16_t * ret_val);
+    bool Get_uint32(uint8_t param, uint32_t * ret_val);
+    bool Get_int8(uint8_t param, int8_t * ret_val);
+    bool Get_int16(uint8_t param, int16_t * ret_val);
+    bool Get_int32(uint8_t param, int32_t * ret_val);
+    bool Get_float(uint8_t param, float * ret_val);
+
+    // Parse the first num_values parameters (values may be partially written on failure)
+    bool Get_floats(float * values, uint8_t num_values);
+
     // ASCII TX buffer interface
     bool Add_uint8(uint8_t val);
     bool Add_uint16(uint16_t val);
@@ -101,6 +253,9 @@ public:
     // String RX buffer interface
     bool Get_string(char * buffer, uint16_t buffer_size);
 
+    // Checksum a contiguous buffer in one pass, continuing from the given check_a/check_b
+    static void BlockChecksum(const uint8_t * buffer, uint32_t length, uint8_t * check_a, uint8_t * check_b);
+
     // ASCII messages with buffers
     ASCII_MSG_t ascii_rx = {0};
     ASCII_MSG_t ascii_tx = {0};
@@ -109,46 +264,178 @@ public:
     BIN_MSG_t binary_rx = {0};
     BIN_MSG_t binary_tx = {0};
 
+    // Reassembled large binary message
+    LARGE_BIN_MSG_t large_binary_rx = {0};
+
     // String messages with buffers
     STRING_MSG_t string_rx = {0};
     STRING_MSG_t string_tx = {0};
 
+    // Bytes of line noise: skipped while searching for the start of a message, or part of a message that was
+    // dropped because it was malformed or didn't finish arriving in time
+    uint32_t discarded_bytes = 0;
+
     // Last ACK/NAK
     uint8_t ack_id = 0;
     bool ack_value = false;
     bool ack_checksum = false;
 
 private:
-    // Receive message parsing
-    bool Read_ASCII(uint32_t timeout);
-    bool Read_Ack(uint32_t timeout);
-    bool Read_Bin(uint32_t timeout);
-    bool Read_String(uint32_t timeout);
+    // Receive message parsing, one character at a time
+    SerialMessage_t ParseChar(char rx_char);
+    void StartFrame(char rx_char);
+    bool Parse_ID(char rx_char);
+    bool Parse_Length(char rx_char);
+    bool Parse_ASCII(char rx_char);
+    bool Parse_Ack(char rx_char);
+    bool Parse_Payload();
+    SerialMessage_t FinishFrame(bool checksum_valid);
+    void CheckDiscard(uint8_t msg_id);
+
+    // Compact frame parsing, COBS decoded from the RX buffer
+    SerialMessage_t Parse_Compact();
+    bool Decode_Compact(const uint8_t * bytes, uint16_t num_bytes);
+    bool Start_Compact();
+    bool Store_Compact(const uint8_t * bytes, uint16_t num_bytes);
+
+    // call the handler for a received message, false if there isn't one
+    bool HandleMessage(SerialMessage_t msg_type);
+
+    // handler table lookup
+    HANDLER_ENTRY_t * FindHandler(SerialMessage_t msg_type, uint8_t msg_id);
+    uint8_t HandlerHash(SerialMessage_t msg_type, uint8_t msg_id);
+    void RebuildHandlers();
+
+    // compress the segments of a binary message into the compression buffer, false if it doesn't get smaller
+    bool Compress_Bin(const BIN_SEGMENT_t * segments, uint8_t num_segments, uint16_t length, uint16_t * compressed_length);
+
+    // decompress part of a received payload into the binary RX buffer, and pass it on to the stream handler if any
+    bool Decode_Bin(const uint8_t * bytes, uint16_t num_bytes);
+
+    // reassemble a received fragment of a large binary message
+    SerialMessage_t Read_Fragment();
+    void ResetLargeRX();
+
+    // bulk read from the stream when the RX buffer has been consumed, false if nothing to parse
+    bool FillRXBuffer();
+    void SkipToDelimiter();
+
+    // abandon the message being parsed, counting the bytes it consumed as discarded
+    void DropFrame();
+
+    // tell the stream end handler how the payload being streamed ended
+    void EndStream(BinStreamResult_t result);
+
+    // accumulate numerical header fields (id, length, checksum) digit by digit
+    bool AddFieldChar(char rx_char, uint8_t max_chars);
+    bool ConvertField(uint16_t max_val, uint16_t * value);
+    void ResetField();
 
     // reset RX/TX internal state
     void ResetRX();
     void ResetTX();
 
-    // deal with safely reading characters and updating the checksum
-    bool GetNextChar(char * new_char);
-    bool ReadSpecificChar(uint32_t timeout, char specific_char);
-
     // deal with safely writing characters and updating the checksum
     void WriteBinByte(uint8_t new_byte);
+    void WriteBinBuffer(const uint8_t * buffer, uint16_t length);
     void WriteChar(char new_char);
     void WriteASCIIu8(uint8_t new_u8);
     void WriteASCIIu16(uint16_t new_u16);
 
-    // read or write the checksum (concatenate a and b into a uint16_t)
-    bool ReadChecksum(uint32_t timeout);
+    // add a formatted integer parameter to the ASCII TX buffer
+    bool Add_decimal(uint32_t magnitude, bool negative);
+
+    // add parameters without checking for room in the ASCII TX buffer, for typed messages that always fit
+    template <uint8_t ID, typename... Params> friend class ASCIIMessage;
+    void Append_decimal(uint32_t magnitude, bool negative);
+    void Append_float(float val);
+
+    // parse the next integer parameter from the ASCII RX buffer, with a magnitude limit for each sign
+    bool Get_integer(uint32_t max_positive, uint32_t max_negative, uint32_t * magnitude, bool * negative);
+
+    // position the ASCII RX buffer at a parameter, false if there aren't that many
+    bool Seek_Param(uint8_t param);
+
+    // check or write the checksum (concatenate a and b into a uint16_t)
+    bool CheckChecksum();
     void WriteChecksum();
 
+    // finish the message with a newline and send it, or send what's been assembled so far
+    void EndFrame();
+    void SendFrame();
+
+    // assemble and send a compact frame, COBS encoding into the TX frame buffer
+    void TX_Compact(char type, uint8_t msg_id, const BIN_SEGMENT_t * segments, uint8_t num_segments);
+    void WriteCompact(const uint8_t * buffer, uint16_t length);
+    void StartCOBSBlock();
+    void EncodeCOBS(const uint8_t * buffer, uint16_t length);
+
     // checksum calculation and values
     void UpdateChecksum(uint8_t new_byte);
     void ResetChecksum();
     uint8_t check_a = 0;
     uint8_t check_b = 0;
 
+    // RX keeps its own checksum since a message can be sent while one is partially received
+    void UpdateRXChecksum(uint8_t new_byte);
+    void ResetRXChecksum();
+    uint8_t rx_check_a = 0;
+    uint8_t rx_check_b = 0;
+
+    // ASCII RX buffer offset of each parameter's leading comma
+    uint8_t param_offsets[ASCII_PARAM_INDEX_SIZE] = {0};
+
+    // incremental RX parser state
+    RXState_t rx_state = RX_IDLE;
+    SerialMessage_t rx_type = NO_MESSAGE;
+    uint32_t rx_start = 0;
+    uint32_t rx_window = READ_TIMEOUT;
+    uint16_t rx_index = 0;
+    uint16_t rx_length = 0;
+    bool rx_discard = false; // parsing a message without a handler that won't be stored
+    uint32_t rx_frame_bytes = 0; // consumed by the message being parsed
+    uint32_t rx_field_value = 0;
+    uint8_t rx_field_length = 0; // uint16 up to 5 chars long
+    uint8_t rx_version = 0; // version offered by the peer
+
+    // compact frame decoding
+    uint8_t rx_header[COMPACT_HEADER_SIZE] = {0};
+    uint8_t rx_cobs_remaining = 0; // data bytes left in the current COBS block
+    bool rx_cobs_zero = false; // the current block ends with an implied zero
+
+    // bytes read from the stream that haven't been parsed yet
+    uint8_t rx_buffer[RX_BUFFER_SIZE] = {0};
+    uint16_t rx_buffer_head = 0;
+    uint16_t rx_buffer_tail = 0;
+
+    // message handlers
+    HANDLER_ENTRY_t handlers[HANDLER_TABLE_SIZE];
+    uint8_t handler_tombstones = 0; // unregistered slots that keep their key so probe sequences aren't broken
+    bool drop_unhandled = false;
+
+    // binary payload streaming
+    BinStreamHandler_t bin_stream_handler = NULL;
+    BinStreamEndHandler_t bin_stream_end_handler = NULL;
+    void * bin_stream_context = NULL;
+    bool rx_streaming = false; // the payload being parsed is streamed to the handler
+
+    // binary payload compression, compressed payloads are decoded straight into the binary RX buffer
+    uint8_t * compress_buffer = NULL;
+    uint16_t compress_buffer_size = 0;
+    LZ_DECODER_t rx_decoder = {LZ_CONTROL, 0, 0, 0};
+    bool rx_compressed = false;
+
+    // TX frame assembly buffer
+    uint8_t tx_frame[TX_FRAME_SIZE] = {0};
+    uint16_t tx_frame_length = 0;
+
+    // framing for transmitted messages, and the open COBS block (position of its code byte and its length)
+    Framing_t framing = FRAMING_TEXT;
+    bool negotiate_framing = false; // accept a compact framing offer from the peer
+    bool peer_decompress = false; // the peer has announced that it can decompress binary messages
+    uint16_t tx_cobs_code = 0;
+    uint8_t tx_cobs_run = 0;
+
     // Serial port
     Stream * serial_stream;
 
@@ -9,92 +9,96 @@
  *  increment the index variable automatically and only if bytes on the buffer are
  *  actually used.
  *
- *  The maximum buffer size supported is 65531 (ie. UINT16_MAX - 4)
+ *  The maximum buffer size supported is 65531 (ie. UINT16_MAX - 4). Every function is also
+ *  overloaded for a uint32_t buffer size and index, for boards with the RAM for larger buffers.
  */
 
 #include "Serialize.h"
 
-#define NULL nullptr
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 // Default to big endian
 Endianness_t endianness = SERIALIZE_BIG_ENDIAN;
 
-// --- Safely add data to the buffer, return success ---
+// dispatch on the global endianness to the compile-time byte order templates
 
-bool BufferAddUInt8(uint8_t data, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index)
+template <typename T, typename Index_t>
+static bool BufferAddOrdered(T data, uint8_t * buffer, Index_t buffer_size, Index_t * curr_index)
 {
-    // check for NULL pointers
-    if (NULL == buffer || NULL == curr_index) return false;
-
-    // ensure we don't overrun the buffer
-    if (*curr_index + sizeof(uint8_t) > buffer_size) return false;
-
-    buffer[(*curr_index)++] = data;
-
-    return true;
+    if (SERIALIZE_BIG_ENDIAN == endianness) {
+        return BufferAdd<SERIALIZE_BIG_ENDIAN>(data, buffer, buffer_size, curr_index);
+    } else {
+        return BufferAdd<SERIALIZE_LITTLE_ENDIAN>(data, buffer, buffer_size, curr_index);
+    }
 }
 
-bool BufferAddUInt16(uint16_t data, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index)
+template <typename T, typename Index_t>
+static bool BufferGetOrdered(T * data, uint8_t * buffer, Index_t buffer_size, Index_t * curr_index)
 {
-    // check for NULL pointers
-    if (NULL == buffer || NULL == curr_index) return false;
-
-    // ensure we don't overrun the buffer
-    if (*curr_index + sizeof(uint16_t) > buffer_size) return false;
-
     if (SERIALIZE_BIG_ENDIAN == endianness) {
-        buffer[(*curr_index)++] = (data >> 8) & 0xFF;
-        buffer[(*curr_index)++] = data & 0xFF;
+        return BufferGet<SERIALIZE_BIG_ENDIAN>(data, buffer, buffer_size, curr_index);
     } else {
-        buffer[(*curr_index)++] = data & 0xFF;
-        buffer[(*curr_index)++] = data >> 8;
+        return BufferGet<SERIALIZE_LITTLE_ENDIAN>(data, buffer, buffer_size, curr_index);
     }
-
-    return true;
 }
 
-bool BufferAddUInt32(uint32_t data, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index)
+template <typename T, typename Index_t>
+static bool BufferAddArrayOrdered(const T * data, Index_t num_values, uint8_t * buffer, Index_t buffer_size, Index_t * curr_index)
 {
-    // check for NULL pointers
-    if (NULL == buffer || NULL == curr_index) return false;
-
-    // ensure we don't overrun the buffer
-    if (*curr_index + sizeof(uint32_t) > buffer_size) return false;
+    if (SERIALIZE_BIG_ENDIAN == endianness) {
+        return BufferAddArray<SERIALIZE_BIG_ENDIAN>(data, num_values, buffer, buffer_size, curr_index);
+    } else {
+        return BufferAddArray<SERIALIZE_LITTLE_ENDIAN>(data, num_values, buffer, buffer_size, curr_index);
+    }
+}
 
+template <typename T, typename Index_t>
+static bool BufferGetArrayOrdered(T * data, Index_t num_values, uint8_t * buffer, Index_t buffer_size, Index_t * curr_index)
+{
     if (SERIALIZE_BIG_ENDIAN == endianness) {
-        buffer[(*curr_index)++] = (data >> 24) & 0xFF;
-        buffer[(*curr_index)++] = (data >> 16) & 0xFF;
-        buffer[(*curr_index)++] = (data >> 8) & 0xFF;
-        buffer[(*curr_index)++] = data & 0xFF;
+        return BufferGetArray<SERIALIZE_BIG_ENDIAN>(data, num_values, buffer, buffer_size, curr_index);
     } else {
-        buffer[(*curr_index)++] = data & 0xFF;
-        buffer[(*curr_index)++] = (data >> 8) & 0xFF;
-        buffer[(*curr_index)++] = (data >> 16) & 0xFF;
-        buffer[(*curr_index)++] = (data >> 24) & 0xFF;
+        return BufferGetArray<SERIALIZE_LITTLE_ENDIAN>(data, num_values, buffer, buffer_size, curr_index);
     }
+}
 
-    return true;
+// --- Safely add data to the buffer, return success ---
+
+bool BufferAddUInt8(uint8_t data, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index)
+{
+    return BufferAddOrdered(data, buffer, buffer_size, curr_index);
+}
+
+bool BufferAddUInt16(uint16_t data, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index)
+{
+    return BufferAddOrdered(data, buffer, buffer_size, curr_index);
+}
+
+bool BufferAddUInt32(uint32_t data, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index)
+{
+    return BufferAddOrdered(data, buffer, buffer_size, curr_index);
 }
 
 bool BufferAddInt8(int8_t data, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index)
 {
-    return BufferAddUInt8((uint8_t) data, buffer, buffer_size, curr_index);
+    return BufferAddOrdered(data, buffer, buffer_size, curr_index);
 }
 
 bool BufferAddInt16(int16_t data, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index)
 {
-    return BufferAddUInt16((int16_t) data, buffer, buffer_size, curr_index);
+    return BufferAddOrdered(data, buffer, buffer_size, curr_index);
 }
 
 bool BufferAddInt32(int32_t data, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index)
 {
-    return BufferAddUInt32((int32_t) data, buffer, buffer_size, curr_index);
+    return BufferAddOrdered(data, buffer, buffer_size, curr_index);
 }
 
 bool BufferAddFloat(float data, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index)
 {
-    uint32_t * temp = (uint32_t *) &data;
-    return BufferAddUInt32(*temp, buffer, buffer_size, curr_index);
+    return BufferAddOrdered(data, buffer, buffer_size, curr_index);
 }
 
 
@@ -102,106 +106,439 @@ bool BufferAddFloat(float data, uint8_t * buffer, uint16_t buffer_size, uint16_t
 
 bool BufferGetUInt8(uint8_t * data, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index)
 {
+    return BufferGetOrdered(data, buffer, buffer_size, curr_index);
+}
+
+bool BufferGetUInt16(uint16_t * data, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index)
+{
+    return BufferGetOrdered(data, buffer, buffer_size, curr_index);
+}
+
+bool BufferGetUInt32(uint32_t * data, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index)
+{
+    return BufferGetOrdered(data, buffer, buffer_size, curr_index);
+}
+
+bool BufferGetInt8(int8_t * data, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index)
+{
+    return BufferGetOrdered(data, buffer, buffer_size, curr_index);
+}
+
+bool BufferGetInt16(int16_t * data, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index)
+{
+    return BufferGetOrdered(data, buffer, buffer_size, curr_index);
+}
+
+bool BufferGetInt32(int32_t * data, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index)
+{
+    return BufferGetOrdered(data, buffer, buffer_size, curr_index);
+}
+
+bool BufferGetFloat(float * data, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index)
+{
+    return BufferGetOrdered(data, buffer, buffer_size, curr_index);
+}
+
+
+// --- Variable-length integer helpers ---
+
+#define VARINT_MAX_SIZE 5
+
+template <typename Index_t>
+static bool AddVarUInt32(uint32_t data, uint8_t * buffer, Index_t buffer_size, Index_t * curr_index)
+{
+    uint8_t num_bytes = 1;
+
     // check for NULL pointers
-    if (NULL == data || NULL == buffer || NULL == curr_index) return false;
+    if (NULL == buffer || NULL == curr_index) return false;
+
+    // size the whole value first so that nothing is written unless it fits
+    while (num_bytes < VARINT_MAX_SIZE && (data >> (7 * num_bytes))) num_bytes++;
 
     // ensure we don't overrun the buffer
-    if (*curr_index + sizeof(uint8_t) > buffer_size) return false;
+    if (!SerializeFits(*curr_index, buffer_size, num_bytes, 1)) return false;
+
+    // seven bits at a time from the least significant, the top bit marks that more follow
+    while (data >= 0x80) {
+        buffer[(*curr_index)++] = (uint8_t) (data | 0x80);
+        data >>= 7;
+    }
 
-    *data = buffer[(*curr_index)++];
+    buffer[(*curr_index)++] = (uint8_t) data;
 
     return true;
 }
 
-bool BufferGetUInt16(uint16_t * data, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index)
+template <typename Index_t>
+static bool AddVarInt32(int32_t data, uint8_t * buffer, Index_t buffer_size, Index_t * curr_index)
+{
+    // zigzag: 0, -1, 1, -2, ... map to 0, 1, 2, 3, ...
+    uint32_t zigzag = ((uint32_t) data << 1) ^ (uint32_t) (data >> 31);
+
+    return AddVarUInt32(zigzag, buffer, buffer_size, curr_index);
+}
+
+template <typename Index_t>
+static bool GetVarUInt32(uint32_t * data, uint8_t * buffer, Index_t buffer_size, Index_t * curr_index)
 {
+    uint32_t value = 0;
+    Index_t index = 0;
+    uint8_t next = 0;
+
     // check for NULL pointers
     if (NULL == data || NULL == buffer || NULL == curr_index) return false;
 
-    // ensure we don't overrun the buffer
-    if (*curr_index + sizeof(uint16_t) > buffer_size) return false;
+    index = *curr_index;
 
-    *data = 0;
+    for (uint8_t i = 0; i < VARINT_MAX_SIZE; i++) {
+        // ensure we don't overrun the buffer
+        if (index >= buffer_size) return false;
 
-    if (SERIALIZE_BIG_ENDIAN == endianness) {
-        *data |= ((uint16_t) buffer[(*curr_index)++]) << 8;
-        *data |= ((uint16_t) buffer[(*curr_index)++]);
-    } else {
-        *data |= ((uint16_t) buffer[(*curr_index)++]);
-        *data |= ((uint16_t) buffer[(*curr_index)++]) << 8;
+        next = buffer[index++];
+
+        // the fifth byte only holds the top four bits, and can't be followed by another
+        if (VARINT_MAX_SIZE - 1 == i && next > 0x0F) return false;
+
+        value |= (uint32_t) (next & 0x7F) << (7 * i);
+
+        if (!(next & 0x80)) {
+            *data = value;
+            *curr_index = index;
+            return true;
+        }
     }
 
+    return false;
+}
+
+template <typename Index_t>
+static bool GetVarInt32(int32_t * data, uint8_t * buffer, Index_t buffer_size, Index_t * curr_index)
+{
+    uint32_t zigzag = 0;
+
+    if (NULL == data || !GetVarUInt32(&zigzag, buffer, buffer_size, curr_index)) return false;
+
+    *data = (int32_t) ((zigzag >> 1) ^ (0 - (zigzag & 1)));
+
     return true;
 }
 
-bool BufferGetUInt32(uint32_t * data, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index)
+// --- Safely add/get variable-length integers, return success ---
+
+bool BufferAddVarUInt32(uint32_t data, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index)
 {
-    // check for NULL pointers
-    if (NULL == data || NULL == buffer || NULL == curr_index) return false;
+    return AddVarUInt32(data, buffer, buffer_size, curr_index);
+}
 
-    // ensure we don't overrun the buffer
-    if (*curr_index + sizeof(uint32_t) > buffer_size) return false;
+bool BufferAddVarInt32(int32_t data, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index)
+{
+    return AddVarInt32(data, buffer, buffer_size, curr_index);
+}
+
+bool BufferGetVarUInt32(uint32_t * data, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index)
+{
+    return GetVarUInt32(data, buffer, buffer_size, curr_index);
+}
 
-    *data = 0;
+bool BufferGetVarInt32(int32_t * data, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index)
+{
+    return GetVarInt32(data, buffer, buffer_size, curr_index);
+}
 
-    if (SERIALIZE_BIG_ENDIAN == endianness) {
-        *data |=  ((uint32_t) buffer[(*curr_index)++]) << 24;
-        *data |= ((uint32_t) buffer[(*curr_index)++]) << 16;
-        *data |= ((uint32_t) buffer[(*curr_index)++]) << 8;
-        *data |= ((uint32_t) buffer[(*curr_index)++]);
+// --- Array helpers ---
+
+// copy 16-bit values, reversing the bytes of each
+static void CopySwap16(uint8_t * dest, const uint8_t * src, uint32_t num_values)
+{
+    uint32_t i = 0;
+    uint16_t value = 0;
+
+#if defined(__SSE2__)
+    __m128i values;
+
+    for (; i + 8 <= num_values; i += 8) {
+        values = _mm_loadu_si128((const __m128i *) (src + 2 * i));
+        values = _mm_or_si128(_mm_slli_epi16(values, 8), _mm_srli_epi16(values, 8));
+        _mm_storeu_si128((__m128i *) (dest + 2 * i), values);
+    }
+#endif
+
+    for (; i < num_values; i++) {
+        memcpy(&value, src + 2 * i, sizeof(uint16_t));
+        value = __builtin_bswap16(value);
+        memcpy(dest + 2 * i, &value, sizeof(uint16_t));
+    }
+}
+
+// copy 32-bit values, reversing the bytes of each
+static void CopySwap32(uint8_t * dest, const uint8_t * src, uint32_t num_values)
+{
+    uint32_t i = 0;
+    uint32_t value = 0;
+
+#if defined(__SSE2__)
+    __m128i values;
+
+    // swap the bytes in each 16-bit half, then swap the halves
+    for (; i + 4 <= num_values; i += 4) {
+        values = _mm_loadu_si128((const __m128i *) (src + 4 * i));
+        values = _mm_or_si128(_mm_slli_epi16(values, 8), _mm_srli_epi16(values, 8));
+        values = _mm_shufflehi_epi16(_mm_shufflelo_epi16(values, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+        _mm_storeu_si128((__m128i *) (dest + 4 * i), values);
+    }
+#endif
+
+    for (; i < num_values; i++) {
+        memcpy(&value, src + 4 * i, sizeof(uint32_t));
+        value = __builtin_bswap32(value);
+        memcpy(dest + 4 * i, &value, sizeof(uint32_t));
+    }
+}
+
+void BufferCopyArray(uint8_t * dest, const uint8_t * src, uint32_t num_values, uint8_t value_size, bool swap)
+{
+    if (1 == value_size || !swap) {
+        memcpy(dest, src, (size_t) num_values * value_size);
+    } else if (2 == value_size) {
+        CopySwap16(dest, src, num_values);
     } else {
-        *data |=  ((uint32_t) buffer[(*curr_index)++]);
-        *data |= ((uint32_t) buffer[(*curr_index)++]) << 8;
-        *data |= ((uint32_t) buffer[(*curr_index)++]) << 16;
-        *data |= ((uint32_t) buffer[(*curr_index)++]) << 24;
+        CopySwap32(dest, src, num_values);
     }
+}
 
-    return true;
+// --- Safely add arrays to the buffer, return success ---
+
+bool BufferAddUInt8Array(const uint8_t * data, uint16_t num_values, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index)
+{
+    return BufferAddArrayOrdered(data, num_values, buffer, buffer_size, curr_index);
 }
 
-bool BufferGetInt8(int8_t * data, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index)
+bool BufferAddUInt16Array(const uint16_t * data, uint16_t num_values, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index)
 {
-    uint8_t placeholder = 0;
+    return BufferAddArrayOrdered(data, num_values, buffer, buffer_size, curr_index);
+}
 
-    if (!BufferGetUInt8(&placeholder, buffer, buffer_size, curr_index)) return false;
+bool BufferAddUInt32Array(const uint32_t * data, uint16_t num_values, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index)
+{
+    return BufferAddArrayOrdered(data, num_values, buffer, buffer_size, curr_index);
+}
 
-    *data = (int8_t) placeholder;
+bool BufferAddInt8Array(const int8_t * data, uint16_t num_values, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index)
+{
+    return BufferAddArrayOrdered(data, num_values, buffer, buffer_size, curr_index);
+}
 
-    return true;
+bool BufferAddInt16Array(const int16_t * data, uint16_t num_values, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index)
+{
+    return BufferAddArrayOrdered(data, num_values, buffer, buffer_size, curr_index);
 }
 
-bool BufferGetInt16(int16_t * data, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index)
+bool BufferAddInt32Array(const int32_t * data, uint16_t num_values, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index)
 {
-    uint16_t placeholder = 0;
+    return BufferAddArrayOrdered(data, num_values, buffer, buffer_size, curr_index);
+}
 
-    if (!BufferGetUInt16(&placeholder, buffer, buffer_size, curr_index)) return false;
+bool BufferAddFloatArray(const float * data, uint16_t num_values, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index)
+{
+    return BufferAddArrayOrdered(data, num_values, buffer, buffer_size, curr_index);
+}
 
-    *data = (int16_t) placeholder;
+// --- Safely get arrays from a buffer, return success ---
 
-    return true;
+bool BufferGetUInt8Array(uint8_t * data, uint16_t num_values, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index)
+{
+    return BufferGetArrayOrdered(data, num_values, buffer, buffer_size, curr_index);
 }
 
-bool BufferGetInt32(int32_t * data, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index)
+bool BufferGetUInt16Array(uint16_t * data, uint16_t num_values, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index)
 {
-    uint32_t placeholder = 0;
+    return BufferGetArrayOrdered(data, num_values, buffer, buffer_size, curr_index);
+}
 
-    if (!BufferGetUInt32(&placeholder, buffer, buffer_size, curr_index)) return false;
+bool BufferGetUInt32Array(uint32_t * data, uint16_t num_values, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index)
+{
+    return BufferGetArrayOrdered(data, num_values, buffer, buffer_size, curr_index);
+}
 
-    *data = (int32_t) placeholder;
+bool BufferGetInt8Array(int8_t * data, uint16_t num_values, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index)
+{
+    return BufferGetArrayOrdered(data, num_values, buffer, buffer_size, curr_index);
+}
 
-    return true;
+bool BufferGetInt16Array(int16_t * data, uint16_t num_values, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index)
+{
+    return BufferGetArrayOrdered(data, num_values, buffer, buffer_size, curr_index);
 }
 
-bool BufferGetFloat(float * data, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index)
+bool BufferGetInt32Array(int32_t * data, uint16_t num_values, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index)
 {
-    uint32_t placeholder = 0;
-    float * temp;
+    return BufferGetArrayOrdered(data, num_values, buffer, buffer_size, curr_index);
+}
 
-    if (!BufferGetUInt32(&placeholder, buffer, buffer_size, curr_index)) return false;
+bool BufferGetFloatArray(float * data, uint16_t num_values, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index)
+{
+    return BufferGetArrayOrdered(data, num_values, buffer, buffer_size, curr_index);
+}
 
-    // cast the integer into a temporary float pointer variable
-    temp = (float *) &placeholder;
-    *data = *temp;
 
-    return true;
+// --- 32-bit sizes ---
+
+bool BufferAddUInt8(uint8_t data, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index)
+{
+    return BufferAddOrdered(data, buffer, buffer_size, curr_index);
+}
+
+bool BufferAddUInt16(uint16_t data, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index)
+{
+    return BufferAddOrdered(data, buffer, buffer_size, curr_index);
+}
+
+bool BufferAddUInt32(uint32_t data, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index)
+{
+    return BufferAddOrdered(data, buffer, buffer_size, curr_index);
+}
+
+bool BufferAddInt8(int8_t data, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index)
+{
+    return BufferAddOrdered(data, buffer, buffer_size, curr_index);
+}
+
+bool BufferAddInt16(int16_t data, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index)
+{
+    return BufferAddOrdered(data, buffer, buffer_size, curr_index);
+}
+
+bool BufferAddInt32(int32_t data, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index)
+{
+    return BufferAddOrdered(data, buffer, buffer_size, curr_index);
+}
+
+bool BufferAddFloat(float data, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index)
+{
+    return BufferAddOrdered(data, buffer, buffer_size, curr_index);
+}
+
+bool BufferGetUInt8(uint8_t * data, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index)
+{
+    return BufferGetOrdered(data, buffer, buffer_size, curr_index);
+}
+
+bool BufferGetUInt16(uint16_t * data, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index)
+{
+    return BufferGetOrdered(data, buffer, buffer_size, curr_index);
+}
+
+bool BufferGetUInt32(uint32_t * data, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index)
+{
+    return BufferGetOrdered(data, buffer, buffer_size, curr_index);
+}
+
+bool BufferGetInt8(int8_t * data, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index)
+{
+    return BufferGetOrdered(data, buffer, buffer_size, curr_index);
+}
+
+bool BufferGetInt16(int16_t * data, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index)
+{
+    return BufferGetOrdered(data, buffer, buffer_size, curr_index);
+}
+
+bool BufferGetInt32(int32_t * data, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index)
+{
+    return BufferGetOrdered(data, buffer, buffer_size, curr_index);
+}
+
+bool BufferGetFloat(float * data, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index)
+{
+    return BufferGetOrdered(data, buffer, buffer_size, curr_index);
+}
+
+bool BufferAddUInt8Array(const uint8_t * data, uint32_t num_values, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index)
+{
+    return BufferAddArrayOrdered(data, num_values, buffer, buffer_size, curr_index);
+}
+
+bool BufferAddUInt16Array(const uint16_t * data, uint32_t num_values, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index)
+{
+    return BufferAddArrayOrdered(data, num_values, buffer, buffer_size, curr_index);
+}
+
+bool BufferAddUInt32Array(const uint32_t * data, uint32_t num_values, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index)
+{
+    return BufferAddArrayOrdered(data, num_values, buffer, buffer_size, curr_index);
+}
+
+bool BufferAddInt8Array(const int8_t * data, uint32_t num_values, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index)
+{
+    return BufferAddArrayOrdered(data, num_values, buffer, buffer_size, curr_index);
+}
+
+bool BufferAddInt16Array(const int16_t * data, uint32_t num_values, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index)
+{
+    return BufferAddArrayOrdered(data, num_values, buffer, buffer_size, curr_index);
+}
+
+bool BufferAddInt32Array(const int32_t * data, uint32_t num_values, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index)
+{
+    return BufferAddArrayOrdered(data, num_values, buffer, buffer_size, curr_index);
+}
+
+bool BufferAddFloatArray(const float * data, uint32_t num_values, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index)
+{
+    return BufferAddArrayOrdered(data, num_values, buffer, buffer_size, curr_index);
+}
+
+bool BufferGetUInt8Array(uint8_t * data, uint32_t num_values, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index)
+{
+    return BufferGetArrayOrdered(data, num_values, buffer, buffer_size, curr_index);
+}
+
+bool BufferGetUInt16Array(uint16_t * data, uint32_t num_values, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index)
+{
+    return BufferGetArrayOrdered(data, num_values, buffer, buffer_size, curr_index);
+}
+
+bool BufferGetUInt32Array(uint32_t * data, uint32_t num_values, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index)
+{
+    return BufferGetArrayOrdered(data, num_values, buffer, buffer_size, curr_index);
+}
+
+bool BufferGetInt8Array(int8_t * data, uint32_t num_values, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index)
+{
+    return BufferGetArrayOrdered(data, num_values, buffer, buffer_size, curr_index);
+}
+
+bool BufferGetInt16Array(int16_t * data, uint32_t num_values, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index)
+{
+    return BufferGetArrayOrdered(data, num_values, buffer, buffer_size, curr_index);
+}
+
+bool BufferGetInt32Array(int32_t * data, uint32_t num_values, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index)
+{
+    return BufferGetArrayOrdered(data, num_values, buffer, buffer_size, curr_index);
+}
+
+bool BufferGetFloatArray(float * data, uint32_t num_values, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index)
+{
+    return BufferGetArrayOrdered(data, num_values, buffer, buffer_size, curr_index);
+}
+
+bool BufferAddVarUInt32(uint32_t data, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index)
+{
+    return AddVarUInt32(data, buffer, buffer_size, curr_index);
+}
+
+bool BufferAddVarInt32(int32_t data, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index)
+{
+    return AddVarInt32(data, buffer, buffer_size, curr_index);
+}
+
+bool BufferGetVarUInt32(uint32_t * data, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index)
+{
+    return GetVarUInt32(data, buffer, buffer_size, curr_index);
+}
+
+bool BufferGetVarInt32(int32_t * data, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index)
+{
+    return GetVarInt32(data, buffer, buffer_size, curr_index);
 }
@@ -9,17 +9,30 @@
  *  increment the index variable automatically and only if bytes on the buffer are
  *  actually used.
  *
- *  The maximum buffer size supported is 65531 (ie. UINT16_MAX - 4)
+ *  The maximum buffer size supported is 65531 (ie. UINT16_MAX - 4). Every function is also
+ *  overloaded for a uint32_t buffer size and index, for boards with the RAM for larger buffers.
  */
 
+#ifndef SERIALIZE_H
+#define SERIALIZE_H
+
 #include <stdint.h>
+#include <string.h>
 
 enum Endianness_t : uint8_t {
     SERIALIZE_BIG_ENDIAN,
     SERIALIZE_LITTLE_ENDIAN
 };
 
+// byte order of the host, values in this order are copied without swapping
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#define SERIALIZE_NATIVE_ENDIAN SERIALIZE_BIG_ENDIAN
+#else
+#define SERIALIZE_NATIVE_ENDIAN SERIALIZE_LITTLE_ENDIAN
+#endif
+
 // allow the user to choose an endianness (must be a variable, not macro since used in many projects)
+// the functions below follow it, the templates at the end of this file take the byte order as a parameter
 
 extern Endianness_t endianness;
 
@@ -45,4 +58,435 @@ bool BufferGetInt8(int8_t * data, uint8_t * buffer, uint16_t buffer_size, uint16
 bool BufferGetInt16(int16_t * data, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index);
 bool BufferGetInt32(int32_t * data, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index);
 
-bool BufferGetFloat(float * data, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index);
\ No newline at end of file
+bool BufferGetFloat(float * data, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index);
+
+// --- Safely add/get arrays with a single bounds check, return success ---
+// arrays are copied in bulk when the host byte order matches, otherwise byte swapped in bulk
+
+bool BufferAddUInt8Array(const uint8_t * data, uint16_t num_values, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index);
+bool BufferAddUInt16Array(const uint16_t * data, uint16_t num_values, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index);
+bool BufferAddUInt32Array(const uint32_t * data, uint16_t num_values, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index);
+
+bool BufferAddInt8Array(const int8_t * data, uint16_t num_values, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index);
+bool BufferAddInt16Array(const int16_t * data, uint16_t num_values, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index);
+bool BufferAddInt32Array(const int32_t * data, uint16_t num_values, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index);
+
+bool BufferAddFloatArray(const float * data, uint16_t num_values, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index);
+
+bool BufferGetUInt8Array(uint8_t * data, uint16_t num_values, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index);
+bool BufferGetUInt16Array(uint16_t * data, uint16_t num_values, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index);
+bool BufferGetUInt32Array(uint32_t * data, uint16_t num_values, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index);
+
+bool BufferGetInt8Array(int8_t * data, uint16_t num_values, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index);
+bool BufferGetInt16Array(int16_t * data, uint16_t num_values, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index);
+bool BufferGetInt32Array(int32_t * data, uint16_t num_values, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index);
+
+bool BufferGetFloatArray(float * data, uint16_t num_values, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index);
+
+// --- Safely add/get variable-length integers, return success ---
+// LEB128 varints use 1 byte for values below 128, 2 below 16384, up to 5 bytes. Signed values are zigzag
+// encoded first, so small negative numbers are short too. Byte order doesn't apply.
+
+bool BufferAddVarUInt32(uint32_t data, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index);
+bool BufferAddVarInt32(int32_t data, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index);
+
+bool BufferGetVarUInt32(uint32_t * data, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index);
+bool BufferGetVarInt32(int32_t * data, uint8_t * buffer, uint16_t buffer_size, uint16_t * curr_index);
+
+// --- 32-bit sizes ---
+// the same functions for a buffer size and index up to UINT32_MAX, selected by passing a uint32_t index
+
+bool BufferAddUInt8(uint8_t data, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index);
+bool BufferAddUInt16(uint16_t data, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index);
+bool BufferAddUInt32(uint32_t data, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index);
+
+bool BufferAddInt8(int8_t data, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index);
+bool BufferAddInt16(int16_t data, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index);
+bool BufferAddInt32(int32_t data, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index);
+
+bool BufferAddFloat(float data, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index);
+
+bool BufferGetUInt8(uint8_t * data, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index);
+bool BufferGetUInt16(uint16_t * data, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index);
+bool BufferGetUInt32(uint32_t * data, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index);
+
+bool BufferGetInt8(int8_t * data, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index);
+bool BufferGetInt16(int16_t * data, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index);
+bool BufferGetInt32(int32_t * data, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index);
+
+bool BufferGetFloat(float * data, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index);
+
+bool BufferAddUInt8Array(const uint8_t * data, uint32_t num_values, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index);
+bool BufferAddUInt16Array(const uint16_t * data, uint32_t num_values, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index);
+bool BufferAddUInt32Array(const uint32_t * data, uint32_t num_values, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index);
+
+bool BufferAddInt8Array(const int8_t * data, uint32_t num_values, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index);
+bool BufferAddInt16Array(const int16_t * data, uint32_t num_values, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index);
+bool BufferAddInt32Array(const int32_t * data, uint32_t num_values, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index);
+
+bool BufferAddFloatArray(const float * data, uint32_t num_values, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index);
+
+bool BufferGetUInt8Array(uint8_t * data, uint32_t num_values, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index);
+bool BufferGetUInt16Array(uint16_t * data, uint32_t num_values, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index);
+bool BufferGetUInt32Array(uint32_t * data, uint32_t num_values, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index);
+
+bool BufferGetInt8Array(int8_t * data, uint32_t num_values, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index);
+bool BufferGetInt16Array(int16_t * data, uint32_t num_values, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index);
+bool BufferGetInt32Array(int32_t * data, uint32_t num_values, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index);
+
+bool BufferGetFloatArray(float * data, uint32_t num_values, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index);
+
+bool BufferAddVarUInt32(uint32_t data, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index);
+bool BufferAddVarInt32(int32_t data, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index);
+
+bool BufferGetVarUInt32(uint32_t * data, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index);
+bool BufferGetVarInt32(int32_t * data, uint8_t * buffer, uint32_t buffer_size, uint32_t * curr_index);
+
+// --- Serialize with a compile-time byte order ---
+// eg. BufferAdd<SERIALIZE_LITTLE_ENDIAN>(data, buffer, buffer_size, &curr_index)
+// these don't depend on the global endianness, and in the native byte order compile down to a single load/store
+// the size type follows the index, which can be uint16_t or uint32_t
+
+// unsigned integer holding the bits of each supported type
+template <typename T> struct SerializeBits;
+template <> struct SerializeBits<uint8_t>  { typedef uint8_t type; };
+template <> struct SerializeBits<uint16_t> { typedef uint16_t type; };
+template <> struct SerializeBits<uint32_t> { typedef uint32_t type; };
+template <> struct SerializeBits<int8_t>   { typedef uint8_t type; };
+template <> struct SerializeBits<int16_t>  { typedef uint16_t type; };
+template <> struct SerializeBits<int32_t>  { typedef uint32_t type; };
+template <> struct SerializeBits<float>    { typedef uint32_t type; };
+
+inline uint8_t SerializeSwap(uint8_t bits) { return bits; }
+inline uint16_t SerializeSwap(uint16_t bits) { return __builtin_bswap16(bits); }
+inline uint32_t SerializeSwap(uint32_t bits) { return __builtin_bswap32(bits); }
+
+// supported index types, used so the buffer size (often a literal) isn't deduced separately from the index
+template <typename Index_t> struct SerializeIndex;
+template <> struct SerializeIndex<uint16_t> { typedef uint16_t type; };
+template <> struct SerializeIndex<uint32_t> { typedef uint32_t type; };
+
+// check that num_values of value_size bytes fit in the rest of the buffer, without overflowing the index
+template <typename Index_t>
+inline bool SerializeFits(Index_t curr_index, Index_t buffer_size, uint32_t num_values, uint8_t value_size)
+{
+    return curr_index <= buffer_size && num_values <= (uint32_t) (buffer_size - curr_index) / value_size;
+}
+
+// the buffer may not be aligned, memcpy compiles down to plain loads and stores
+template <Endianness_t ORDER, typename T>
+inline void SerializeStore(uint8_t * dest, T data)
+{
+    typename SerializeBits<T>::type bits;
+    static_assert(sizeof(bits) == sizeof(T), "unsupported serialize type");
+
+    memcpy(&bits, &data, sizeof(bits));
+    if (SERIALIZE_NATIVE_ENDIAN != ORDER) bits = SerializeSwap(bits);
+    memcpy(dest, &bits, sizeof(bits));
+}
+
+template <Endianness_t ORDER, typename T>
+inline void SerializeLoad(T * data, const uint8_t * src)
+{
+    typename SerializeBits<T>::type bits;
+    static_assert(sizeof(bits) == sizeof(T), "unsupported serialize type");
+
+    memcpy(&bits, src, sizeof(bits));
+    if (SERIALIZE_NATIVE_ENDIAN != ORDER) bits = SerializeSwap(bits);
+    memcpy(data, &bits, sizeof(bits));
+}
+
+template <Endianness_t ORDER, typename T, typename Index_t>
+inline bool BufferAdd(T data, uint8_t * buffer, typename SerializeIndex<Index_t>::type buffer_size, Index_t * curr_index)
+{
+    // check for NULL pointers
+    if (nullptr == buffer || nullptr == curr_index) return false;
+
+    // ensure we don't overrun the buffer
+    if (!SerializeFits(*curr_index, buffer_size, 1, sizeof(T))) return false;
+
+    SerializeStore<ORDER>(buffer + *curr_index, data);
+    *curr_index += sizeof(T);
+
+    return true;
+}
+
+template <Endianness_t ORDER, typename T, typename Index_t>
+inline bool BufferGet(T * data, const uint8_t * buffer, typename SerializeIndex<Index_t>::type buffer_size, Index_t * curr_index)
+{
+    // check for NULL pointers
+    if (nullptr == data || nullptr == buffer || nullptr == curr_index) return false;
+
+    // ensure we don't overrun the buffer
+    if (!SerializeFits(*curr_index, buffer_size, 1, sizeof(T))) return false;
+
+    SerializeLoad<ORDER>(data, buffer + *curr_index);
+    *curr_index += sizeof(T);
+
+    return true;
+}
+
+// copy values into or out of a buffer, reversing the bytes of each if swap is set
+void BufferCopyArray(uint8_t * dest, const uint8_t * src, uint32_t num_values, uint8_t value_size, bool swap);
+
+template <Endianness_t ORDER, typename T, typename Index_t>
+inline bool BufferAddArray(const T * data, typename SerializeIndex<Index_t>::type num_values, uint8_t * buffer,
+                           typename SerializeIndex<Index_t>::type buffer_size, Index_t * curr_index)
+{
+    static_assert(sizeof(typename SerializeBits<T>::type) == sizeof(T), "unsupported serialize type");
+
+    // check for NULL pointers
+    if (nullptr == data || nullptr == buffer || nullptr == curr_index) return false;
+
+    // ensure we don't overrun the buffer
+    if (!SerializeFits(*curr_index, buffer_size, num_values, sizeof(T))) return false;
+
+    BufferCopyArray(buffer + *curr_index, (const uint8_t *) data, num_values, sizeof(T), SERIALIZE_NATIVE_ENDIAN != ORDER);
+    *curr_index += num_values * sizeof(T);
+
+    return true;
+}
+
+template <Endianness_t ORDER, typename T, typename Index_t>
+inline bool BufferGetArray(T * data, typename SerializeIndex<Index_t>::type num_values, const uint8_t * buffer,
+                           typename SerializeIndex<Index_t>::type buffer_size, Index_t * curr_index)
+{
+    static_assert(sizeof(typename SerializeBits<T>::type) == sizeof(T), "unsupported serialize type");
+
+    // check for NULL pointers
+    if (nullptr == data || nullptr == buffer || nullptr == curr_index) return false;
+
+    // ensure we don't overrun the buffer
+    if (!SerializeFits(*curr_index, buffer_size, num_values, sizeof(T))) return false;
+
+    BufferCopyArray((uint8_t *) data, buffer + *curr_index, num_values, sizeof(T), SERIALIZE_NATIVE_ENDIAN != ORDER);
+    *curr_index += num_values * sizeof(T);
+
+    return true;
+}
+
+// --- Fixed-layout records ---
+// A record type is declared once from its field types, eg.
+//     typedef BufferRecord<SERIALIZE_BIG_ENDIAN, float, float, uint16_t> Telemetry_Record;
+// Telemetry_Record::size is the packed size at compile time, Pack() writes every field after a single
+// bounds check, and Unpack() reads them straight out of a buffer (such as binary_rx.bin_buffer). Either
+// all of the fields are written or none are.
+
+template <typename... Fields> struct SerializeSize;
+template <> struct SerializeSize<> { static constexpr uint32_t size = 0; };
+template <typename First, typename... Rest> struct SerializeSize<First, Rest...> {
+    static constexpr uint32_t size = sizeof(typename SerializeBits<First>::type) + SerializeSize<Rest...>::size;
+};
+
+template <Endianness_t ORDER, typename... Fields>
+class BufferRecord {
+public:
+    static constexpr uint32_t size = SerializeSize<Fields...>::size;
+
+    template <typename Index_t>
+    static bool Pack(uint8_t * buffer, typename SerializeIndex<Index_t>::type buffer_size, Index_t * curr_index, Fields... fields)
+    {
+        // check for NULL pointers
+        if (nullptr == buffer || nullptr == curr_index) return false;
+
+        // ensure we don't overrun the buffer
+        if (!SerializeFits(*curr_index, buffer_size, size, 1)) return false;
+
+        Store(buffer + *curr_index, fields...);
+        *curr_index += size;
+
+        return true;
+    }
+
+    template <typename Index_t>
+    static bool Unpack(const uint8_t * buffer, typename SerializeIndex<Index_t>::type buffer_size, Index_t * curr_index, Fields *... fields)
+    {
+        // check for NULL pointers
+        if (nullptr == buffer || nullptr == curr_index || !Valid(fields...)) return false;
+
+        // ensure we don't overrun the buffer
+        if (!SerializeFits(*curr_index, buffer_size, size, 1)) return false;
+
+        Load(buffer + *curr_index, fields...);
+        *curr_index += size;
+
+        return true;
+    }
+
+private:
+    static void Store(uint8_t * dest) { (void) dest; }
+
+    template <typename First, typename... Rest>
+    static void Store(uint8_t * dest, First first, Rest... rest)
+    {
+        SerializeStore<ORDER>(dest, first);
+        Store(dest + sizeof(First), rest...);
+    }
+
+    static void Load(const uint8_t * src) { (void) src; }
+
+    template <typename First, typename... Rest>
+    static void Load(const uint8_t * src, First * first, Rest *... rest)
+    {
+        SerializeLoad<ORDER>(first, src);
+        Load(src + sizeof(First), rest...);
+    }
+
+    static bool Valid() { return true; }
+
+    template <typename First, typename... Rest>
+    static bool Valid(First * first, Rest *... rest)
+    {
+        return nullptr != first && Valid(rest...);
+    }
+};
+
+// --- Buffer cursors ---
+// BufferWriter and BufferReader hold the buffer, its size and the current index. Add/Get check every
+// field, or a fixed-size record can be checked once with Reserve(num_bytes) and then written or read
+// with the unchecked Put/Take. Any failed check sets a sticky error, so a record can be packed with Add
+// and checked once with Error() at the end, since nothing more is written after the first failure.
+
+template <Endianness_t ORDER = SERIALIZE_BIG_ENDIAN, typename Index_t = uint16_t>
+class BufferWriter {
+public:
+    BufferWriter(uint8_t * buffer, Index_t buffer_size)
+        : buffer(buffer), buffer_size(buffer_size), index(0), error(nullptr == buffer) { }
+
+    // check that num_bytes more fit in the buffer, which can then be written with Put/PutArray
+    bool Reserve(uint32_t num_bytes) { return Check(num_bytes, 1); }
+
+    // unchecked, only valid for bytes covered by a successful Reserve
+    template <typename T>
+    void Put(T data)
+    {
+        SerializeStore<ORDER>(buffer + index, data);
+        index += sizeof(T);
+    }
+
+    template <typename T>
+    void PutArray(const T * data, uint32_t num_values)
+    {
+        static_assert(sizeof(typename SerializeBits<T>::type) == sizeof(T), "unsupported serialize type");
+
+        BufferCopyArray(buffer + index, (const uint8_t *) data, num_values, sizeof(T), SERIALIZE_NATIVE_ENDIAN != ORDER);
+        index += num_values * sizeof(T);
+    }
+
+    template <typename T>
+    bool Add(T data)
+    {
+        if (!Reserve(sizeof(T))) return false;
+
+        Put(data);
+
+        return true;
+    }
+
+    template <typename T>
+    bool AddArray(const T * data, uint32_t num_values)
+    {
+        if (nullptr == data) error = true;
+        if (!Check(num_values, sizeof(T))) return false;
+
+        PutArray(data, num_values);
+
+        return true;
+    }
+
+    void Reset() { index = 0; error = (nullptr == buffer); }
+
+    Index_t Index() const { return index; }
+    Index_t Remaining() const { return buffer_size - index; }
+    bool Error() const { return error; }
+
+private:
+    bool Check(uint32_t num_values, uint8_t value_size)
+    {
+        if (error || !SerializeFits(index, buffer_size, num_values, value_size)) {
+            error = true;
+            return false;
+        }
+
+        return true;
+    }
+
+    uint8_t * buffer;
+    Index_t buffer_size;
+    Index_t index;
+    bool error;
+};
+
+template <Endianness_t ORDER = SERIALIZE_BIG_ENDIAN, typename Index_t = uint16_t>
+class BufferReader {
+public:
+    BufferReader(const uint8_t * buffer, Index_t buffer_size)
+        : buffer(buffer), buffer_size(buffer_size), index(0), error(nullptr == buffer) { }
+
+    // check that num_bytes more remain in the buffer, which can then be read with Take/TakeArray
+    bool Reserve(uint32_t num_bytes) { return Check(num_bytes, 1); }
+
+    // unchecked, only valid for bytes covered by a successful Reserve
+    template <typename T>
+    void Take(T * data)
+    {
+        SerializeLoad<ORDER>(data, buffer + index);
+        index += sizeof(T);
+    }
+
+    template <typename T>
+    void TakeArray(T * data, uint32_t num_values)
+    {
+        static_assert(sizeof(typename SerializeBits<T>::type) == sizeof(T), "unsupported serialize type");
+
+        BufferCopyArray((uint8_t *) data, buffer + index, num_values, sizeof(T), SERIALIZE_NATIVE_ENDIAN != ORDER);
+        index += num_values * sizeof(T);
+    }
+
+    // the result is only written if the check passes
+    template <typename T>
+    bool Get(T * data)
+    {
+        if (nullptr == data) error = true;
+        if (!Reserve(sizeof(T))) return false;
+
+        Take(data);
+
+        return true;
+    }
+
+    template <typename T>
+    bool GetArray(T * data, uint32_t num_values)
+    {
+        if (nullptr == data) error = true;
+        if (!Check(num_values, sizeof(T))) return false;
+
+        TakeArray(data, num_values);
+
+        return true;
+    }
+
+    void Reset() { index = 0; error = (nullptr == buffer); }
+
+    Index_t Index() const { return index; }
+    Index_t Remaining() const { return buffer_size - index; }
+    bool Error() const { return error; }
+
+private:
+    bool Check(uint32_t num_values, uint8_t value_size)
+    {
+        if (error || !SerializeFits(index, buffer_size, num_values, value_size)) {
+            error = true;
+            return false;
+        }
+
+        return true;
+    }
+
+    const uint8_t * buffer;
+    Index_t buffer_size;
+    Index_t index;
+    bool error;
+};
+
+#endif /* SERIALIZE_H */
@@ -0,0 +1,113 @@
+/*
+ * TypedMessage.h
+ *
+ * This file declares a template for ASCII messages defined by an id and a typed parameter
+ * list. The TX and RX functions for each message are generated at compile time, replacing
+ * hand-written chains of Add_ and Get_ calls.
+ *
+ * The longest formatting of every parameter type is known, so a message definition only
+ * compiles if its parameters are guaranteed to fit in the ASCII buffer, and they are then
+ * written without any per-parameter bounds checks.
+ */
+
+#ifndef TYPEDMESSAGE_H
+#define TYPEDMESSAGE_H
+
+#include "SerialComm.h"
+
+// longest formatting of each parameter type, including the leading comma
+template <typename T> struct ParamSize;
+template <> struct ParamSize<uint8_t>  { static constexpr uint16_t max_chars = 4;  }; // ,255
+template <> struct ParamSize<uint16_t> { static constexpr uint16_t max_chars = 6;  }; // ,65535
+template <> struct ParamSize<uint32_t> { static constexpr uint16_t max_chars = 11; }; // ,4294967295
+template <> struct ParamSize<int8_t>   { static constexpr uint16_t max_chars = 5;  }; // ,-128
+template <> struct ParamSize<int16_t>  { static constexpr uint16_t max_chars = 7;  }; // ,-32768
+template <> struct ParamSize<int32_t>  { static constexpr uint16_t max_chars = 12; }; // ,-2147483648
+template <> struct ParamSize<float>    { static constexpr uint16_t max_chars = 16; }; // ,-1.17549435e-38
+
+template <typename... Params> struct ParamsSize;
+template <> struct ParamsSize<> { static constexpr uint16_t max_chars = 0; };
+template <typename First, typename... Rest> struct ParamsSize<First, Rest...> {
+    static constexpr uint16_t max_chars = ParamSize<First>::max_chars + ParamsSize<Rest...>::max_chars;
+};
+
+template <uint8_t ID, typename... Params>
+class ASCIIMessage {
+public:
+    static const uint8_t msg_id = ID;
+    static constexpr uint16_t max_chars = ParamsSize<Params...>::max_chars;
+
+    // leave room to null-terminate the buffer
+    static_assert(max_chars < ASCII_BUFFER_SIZE, "message parameters may not fit in the ASCII buffer");
+
+    // Send the message, which can't fail since the parameters always fit
+    static void TX(SerialComm * serial, Params... params)
+    {
+        serial->ResetTX();
+        Append(serial, params...);
+        serial->TX_ASCII(ID);
+    }
+
+    // Parse a received message into the parameters, which are only written if the whole message parses
+    static bool RX(SerialComm * serial, Params *... params)
+    {
+        if (ID != serial->ascii_rx.msg_id || sizeof...(Params) != serial->ascii_rx.num_params) return false;
+
+        serial->ascii_rx.buffer_index = 0;
+
+        return Parse(serial, params...);
+    }
+
+private:
+    static void Append(SerialComm * serial) { (void) serial; }
+
+    template <typename First, typename... Rest>
+    static void Append(SerialComm * serial, First first, Rest... rest)
+    {
+        Put(serial, first);
+        Append(serial, rest...);
+    }
+
+    static void Put(SerialComm * serial, uint8_t val)  { serial->Append_decimal(val, false); }
+    static void Put(SerialComm * serial, uint16_t val) { serial->Append_decimal(val, false); }
+    static void Put(SerialComm * serial, uint32_t val) { serial->Append_decimal(val, false); }
+    static void Put(SerialComm * serial, int8_t val)   { Put(serial, (int32_t) val); }
+    static void Put(SerialComm * serial, int16_t val)  { Put(serial, (int32_t) val); }
+    static void Put(SerialComm * serial, float val)    { serial->Append_float(val); }
+
+    static void Put(SerialComm * serial, int32_t val)
+    {
+        // negate as unsigned so that INT32_MIN doesn't overflow
+        if (val < 0) {
+            serial->Append_decimal((uint32_t) 0 - (uint32_t) val, true);
+        } else {
+            serial->Append_decimal((uint32_t) val, false);
+        }
+    }
+
+    static bool Parse(SerialComm * serial) { (void) serial; return true; }
+
+    // each parameter is parsed into a temporary, and written once the rest of the message has parsed
+    template <typename First, typename... Rest>
+    static bool Parse(SerialComm * serial, First * first, Rest *... rest)
+    {
+        First temp;
+
+        if (!Get(serial, &temp)) return false;
+        if (!Parse(serial, rest...)) return false;
+
+        *first = temp;
+
+        return true;
+    }
+
+    static bool Get(SerialComm * serial, uint8_t * val)  { return serial->Get_uint8(val); }
+    static bool Get(SerialComm * serial, uint16_t * val) { return serial->Get_uint16(val); }
+    static bool Get(SerialComm * serial, uint32_t * val) { return serial->Get_uint32(val); }
+    static bool Get(SerialComm * serial, int8_t * val)   { return serial->Get_int8(val); }
+    static bool Get(SerialComm * serial, int16_t * val)  { return serial->Get_int16(val); }
+    static bool Get(SerialComm * serial, int32_t * val)  { return serial->Get_int32(val); }
+    static bool Get(SerialComm * serial, float * val)    { return serial->Get_float(val); }
+};
+
+#endif /* TYPEDMESSAGE_H */
@@ -0,0 +1,174 @@
+/*  ChannelComm_Test.ino
+ *
+ *  Runs two ChannelComm objects against each other over a pair of in-memory loopback
+ *  streams, one sending on two channels and the other receiving them. Checks that messages
+ *  are demultiplexed to their channels, that a channel whose consumer falls behind stalls
+ *  when its credit runs out while the other carries on, that credit is refilled as the
+ *  consumer catches up, and that a lost credit frame is recovered by a sync.
+ */
+
+#include <SerialComm.h>
+#include <ChannelComm.h>
+#include <LoopbackPair.h>
+
+#define SLOW_CHANNEL   0
+#define FAST_CHANNEL   1
+#define NUM_SLOTS      4
+#define MAX_LENGTH     16
+#define FAST_MESSAGES  20
+
+// two SerialComm objects over a connected pair of loopback streams
+LoopbackPair loopback;
+
+uint8_t bin_rx_a[CHANNEL_HEADER_SIZE + MAX_LENGTH] = {0};
+uint8_t bin_rx_b[CHANNEL_HEADER_SIZE + MAX_LENGTH] = {0};
+
+// a only sends, b only receives
+ChannelComm mux_a(&loopback.serial_a);
+ChannelComm mux_b(&loopback.serial_b);
+uint8_t slow_queue[NUM_SLOTS * (MAX_LENGTH + CHANNEL_SLOT_HEADER)] = {0};
+uint8_t fast_queue[NUM_SLOTS * (MAX_LENGTH + CHANNEL_SLOT_HEADER)] = {0};
+
+// every message carries its id as its data
+uint16_t received[2] = {0};
+bool demuxed = true;
+
+void Receive(uint8_t channel, uint8_t msg_id, const uint8_t * data, uint16_t length, void * context)
+{
+  if ((uint8_t) (uintptr_t) context != channel || 1 != length || msg_id != data[0]) demuxed = false;
+  received[channel]++;
+}
+
+bool Send(uint8_t channel, uint8_t msg_id)
+{
+  return mux_a.TX(channel, msg_id, &msg_id, 1);
+}
+
+// messages arrive on the channel they were sent on
+void DemuxTest()
+{
+  bool passed = true;
+  uint8_t msg_id = 0;
+  uint8_t data[MAX_LENGTH] = {0};
+  uint16_t length = 0;
+
+  if (NUM_SLOTS != mux_a.TXAvailable(SLOW_CHANNEL) || NUM_SLOTS != mux_a.TXAvailable(FAST_CHANNEL)) passed = false;
+
+  if (!Send(SLOW_CHANNEL, 10) || !Send(FAST_CHANNEL, 20) || !Send(SLOW_CHANNEL, 11)) passed = false;
+  loopback.Service();
+  if (2 != mux_b.Queued(SLOW_CHANNEL) || 1 != mux_b.Queued(FAST_CHANNEL)) passed = false;
+
+  if (1 != mux_b.Deliver(FAST_CHANNEL, NUM_SLOTS) || 1 != received[FAST_CHANNEL] || 0 != received[SLOW_CHANNEL]) passed = false;
+  if (!mux_b.Read(SLOW_CHANNEL, &msg_id, data, sizeof(data), &length) || 10 != msg_id || 1 != length || 10 != data[0]) passed = false;
+  if (!mux_b.Read(SLOW_CHANNEL, &msg_id, data, sizeof(data), &length) || 11 != msg_id) passed = false;
+  if (!demuxed) passed = false;
+
+  if (passed) {
+    Serial.println("Passed demultiplexing test");
+  } else {
+    Serial.println("FAILED demultiplexing test");
+  }
+}
+
+// a channel whose consumer stops stalls once its credit runs out, while the other channel carries on
+void StallTest()
+{
+  bool passed = true;
+  uint8_t sent = 0;
+
+  loopback.Service();
+  while (sent <= NUM_SLOTS && Send(SLOW_CHANNEL, 30 + sent)) sent++;
+  if (NUM_SLOTS != sent || !mux_a.channels[SLOW_CHANNEL].blocked) passed = false;
+
+  for (uint8_t i = 0; i < FAST_MESSAGES; i++) {
+    if (!Send(FAST_CHANNEL, 40 + i)) passed = false;
+    loopback.Service();
+    mux_b.Deliver(FAST_CHANNEL, NUM_SLOTS);
+  }
+
+  if (1 + FAST_MESSAGES != received[FAST_CHANNEL] || NUM_SLOTS != mux_b.Queued(SLOW_CHANNEL)) passed = false;
+  if (0 != mux_a.TXAvailable(SLOW_CHANNEL) || Send(SLOW_CHANNEL, 50)) passed = false;
+  if (0 != mux_b.channels[SLOW_CHANNEL].overflows || 0 != mux_b.channels[FAST_CHANNEL].overflows) passed = false;
+
+  if (passed) {
+    Serial.println("Passed stall test");
+  } else {
+    Serial.println("FAILED stall test");
+  }
+}
+
+// credit is granted again as the consumer catches up, in batches of half the queue
+void RefillTest()
+{
+  bool passed = true;
+
+  if (NUM_SLOTS != mux_b.Deliver(SLOW_CHANNEL, NUM_SLOTS) || NUM_SLOTS != received[SLOW_CHANNEL]) passed = false;
+  loopback.Service();
+  if (NUM_SLOTS != mux_a.TXAvailable(SLOW_CHANNEL) || mux_a.channels[SLOW_CHANNEL].blocked) passed = false;
+
+  if (!Send(SLOW_CHANNEL, 60) || !Send(SLOW_CHANNEL, 61)) passed = false;
+  loopback.Service();
+  if (2 != mux_b.Deliver(SLOW_CHANNEL, NUM_SLOTS) || !demuxed) passed = false;
+  loopback.Service();
+  if (NUM_SLOTS != mux_a.TXAvailable(SLOW_CHANNEL)) passed = false;
+
+  if (passed) {
+    Serial.println("Passed refill test");
+  } else {
+    Serial.println("FAILED refill test");
+  }
+}
+
+// a blocked sender whose credit frame is lost asks for it again
+void SyncTest()
+{
+  bool passed = true;
+  uint8_t sent = 0;
+
+  loopback.Service();
+  while (sent <= NUM_SLOTS && Send(SLOW_CHANNEL, 70 + sent)) sent++;
+  loopback.Service();
+  if (NUM_SLOTS != sent || NUM_SLOTS != mux_b.Queued(SLOW_CHANNEL)) passed = false;
+
+  // the consumer catches up, but its credit is lost on the way
+  mux_b.Deliver(SLOW_CHANNEL, NUM_SLOTS);
+  loopback.stream_a.clear();
+  if (0 != mux_a.TXAvailable(SLOW_CHANNEL)) passed = false;
+
+  delay(CHANNEL_SYNC_INTERVAL);
+  mux_a.Update();
+  loopback.Service();
+  if (NUM_SLOTS != mux_a.TXAvailable(SLOW_CHANNEL) || mux_a.channels[SLOW_CHANNEL].blocked) passed = false;
+  if (!Send(SLOW_CHANNEL, 80)) passed = false;
+  loopback.Service();
+  if (1 != mux_b.Deliver(SLOW_CHANNEL, NUM_SLOTS) || !demuxed) passed = false;
+
+  if (passed) {
+    Serial.println("Passed sync test");
+  } else {
+    Serial.println("FAILED sync test");
+  }
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  delay(2500);
+
+  loopback.serial_a.AssignBinaryRXBuffer(bin_rx_a, sizeof(bin_rx_a));
+  loopback.serial_b.AssignBinaryRXBuffer(bin_rx_b, sizeof(bin_rx_b));
+  mux_a.Begin();
+  mux_b.Begin();
+  mux_b.Open(SLOW_CHANNEL, slow_queue, sizeof(slow_queue), MAX_LENGTH, Receive, (void *) SLOW_CHANNEL);
+  mux_b.Open(FAST_CHANNEL, fast_queue, sizeof(fast_queue), MAX_LENGTH, Receive, (void *) FAST_CHANNEL);
+  loopback.Service();
+
+  DemuxTest();
+  StallTest();
+  RefillTest();
+  SyncTest();
+}
+
+void loop()
+{
+}
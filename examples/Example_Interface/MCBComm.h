@@ -12,6 +12,7 @@
 #define MCBCOMM_H
 
 #include "SerialComm.h"
+#include "TypedMessage.h"
 
 enum MCBMessages_t : uint8_t {
     MCB_NO_MESSAGE = 0,
@@ -37,36 +38,25 @@ enum MCBMessages_t : uint8_t {
 };
 
 
-class MCBComm : public SerialComm {
-public:
-    MCBComm(Stream * serial_port);
-    ~MCBComm() { };
-
-    // MCB -> DIB/PIB (with params) -----------------------
-
-    bool TX_Motion_Status(float reel_pos, float lw_pos, float reel_torque, float reel_temp, float lw_temp); // todo: voltages? timestamp?
-    bool RX_Motion_Status(float * reel_pos, float * lw_pos, float * reel_torque, float * reel_temp, float * lw_temp);
-
-    // DIB/PIB -> MCB (with params) -----------------------
+// message definitions, each with a generated TX(&mcb, params...) and RX(&mcb, &params...)
 
-    bool TX_Reel_Out(float num_revs, float speed);
-    bool RX_Reel_Out(float * num_revs, float * speed);
+// MCB -> DIB/PIB (with params) ---------------------------
 
-    bool TX_Reel_In(float num_revs, float speed);
-    bool RX_Reel_In(float * num_revs, float * speed);
+typedef ASCIIMessage<MCB_MOTION_STATUS, float, float, float, float, float> MCB_Motion_Status; // reel_pos, lw_pos, reel_torque, reel_temp, lw_temp (todo: voltages? timestamp?)
 
-    bool TX_Dock(float num_revs, float speed);
-    bool RX_Dock(float * num_revs, float * speed);
+// DIB/PIB -> MCB (with params) ---------------------------
 
-    bool TX_Out_Acc(float acceleration);
-    bool RX_Out_Acc(float * acceleration);
-
-    bool TX_In_Acc(float acceleration);
-    bool RX_In_Acc(float * acceleration);
-
-    bool TX_Dock_Acc(float acceleration);
-    bool RX_Dock_Acc(float * acceleration);
+typedef ASCIIMessage<MCB_REEL_OUT, float, float> MCB_Reel_Out; // num_revs, speed
+typedef ASCIIMessage<MCB_REEL_IN, float, float> MCB_Reel_In;   // num_revs, speed
+typedef ASCIIMessage<MCB_DOCK, float, float> MCB_Dock;         // num_revs, speed
+typedef ASCIIMessage<MCB_OUT_ACC, float> MCB_Out_Acc;          // acceleration
+typedef ASCIIMessage<MCB_IN_ACC, float> MCB_In_Acc;            // acceleration
+typedef ASCIIMessage<MCB_DOCK_ACC, float> MCB_Dock_Acc;        // acceleration
 
+class MCBComm : public SerialComm {
+public:
+    MCBComm(Stream * serial_port);
+    ~MCBComm() { };
 };
 
 #endif /* MCBCOMM_H */
\ No newline at end of file
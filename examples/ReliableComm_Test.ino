@@ -0,0 +1,142 @@
+/*  ReliableComm_Test.ino
+ *
+ *  Runs two ReliableComm objects against each other over a pair of in-memory loopback
+ *  streams, and checks that messages are delivered in order and exactly once when a frame
+ *  is dropped, when a frame is duplicated, and when the sequence number wraps past 255.
+ */
+
+#include <SerialComm.h>
+#include <ReliableComm.h>
+#include <LoopbackPair.h>
+
+#define WRAP_MESSAGES 300
+
+// two SerialComm objects over a connected pair of loopback streams
+LoopbackPair loopback;
+
+uint8_t bin_rx_a[RELIABLE_HEADER_SIZE + RELIABLE_PAYLOAD_SIZE] = {0};
+uint8_t bin_rx_b[RELIABLE_HEADER_SIZE + RELIABLE_PAYLOAD_SIZE] = {0};
+
+// every message carries its index, which must arrive in order
+uint16_t delivered = 0;
+bool in_order = true;
+
+void Deliver(uint8_t msg_id, const uint8_t * data, uint16_t length, void * context)
+{
+  uint16_t index = 0;
+
+  if (2 != length) {
+    in_order = false;
+    return;
+  }
+
+  index = (uint16_t) (data[0] | (data[1] << 8));
+  if (index != delivered || msg_id != (uint8_t) index) in_order = false;
+  delivered++;
+}
+
+// a only sends, so its handler is never called
+ReliableComm reliable_a(&loopback.serial_a, Deliver, NULL);
+ReliableComm reliable_b(&loopback.serial_b, Deliver, NULL);
+
+uint16_t next_index = 0;
+
+bool Send()
+{
+  uint8_t data[2] = {(uint8_t) next_index, (uint8_t) (next_index >> 8)};
+
+  if (!reliable_a.TX((uint8_t) next_index, data, 2)) return false;
+
+  next_index++;
+  return true;
+}
+
+// a dropped frame holds up the messages behind it until it's retransmitted, and the one after it isn't resent
+void DropTest()
+{
+  bool passed = true;
+  uint16_t start = delivered;
+
+  Send();
+  loopback.stream_b.clear();
+  Send();
+  loopback.Service();
+  if (delivered != start || 2 != reliable_a.Pending()) passed = false;
+
+  delay(RELIABLE_TIMEOUT);
+  reliable_a.Update();
+  loopback.Service();
+  if (delivered != start + 2 || !in_order || 0 != reliable_a.Pending() || 1 != reliable_a.retransmissions) passed = false;
+
+  if (passed) {
+    Serial.println("Passed dropped frame test");
+  } else {
+    Serial.println("FAILED dropped frame test");
+  }
+}
+
+// a frame that arrives twice is only delivered once
+void DuplicateTest()
+{
+  bool passed = true;
+  uint16_t start = delivered;
+  uint8_t frame[64];
+  uint16_t length = 0;
+
+  Send();
+  length = loopback.stream_b.bytes();
+  if (length > sizeof(frame)) length = sizeof(frame);
+  loopback.stream_b.readBytes(frame, length);
+
+  // writing to a's stream delivers to b
+  loopback.stream_a.write(frame, length);
+  loopback.stream_a.write(frame, length);
+  loopback.Service();
+  if (delivered != start + 1 || !in_order || 1 != reliable_b.duplicates || 0 != reliable_a.Pending()) passed = false;
+
+  if (passed) {
+    Serial.println("Passed duplicate frame test");
+  } else {
+    Serial.println("FAILED duplicate frame test");
+  }
+}
+
+// the sequence number wraps around from 255 to 0 without losing or repeating a message
+void WrapTest()
+{
+  bool passed = true;
+  uint16_t start = delivered;
+
+  while (next_index < start + WRAP_MESSAGES) {
+    if (!Send()) loopback.Service();
+  }
+  loopback.Service();
+
+  if (delivered != start + WRAP_MESSAGES || !in_order || 0 != reliable_a.Pending()) passed = false;
+  if (1 != reliable_a.retransmissions || 1 != reliable_b.duplicates) passed = false;
+
+  if (passed) {
+    Serial.println("Passed sequence wrap test");
+  } else {
+    Serial.println("FAILED sequence wrap test");
+  }
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  delay(2500);
+
+  loopback.serial_a.AssignBinaryRXBuffer(bin_rx_a, sizeof(bin_rx_a));
+  loopback.serial_b.AssignBinaryRXBuffer(bin_rx_b, sizeof(bin_rx_b));
+  reliable_a.Begin();
+  reliable_b.Begin();
+
+  DropTest();
+  DuplicateTest();
+  WrapTest();
+}
+
+void loop()
+{
+}
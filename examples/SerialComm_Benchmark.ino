@@ -0,0 +1,409 @@
+/*  SerialComm_Benchmark.ino
+ *
+ *  Measures SerialComm TX and RX throughput without any hardware in the loop. Messages
+ *  are written into an in-memory loopback stream and then parsed back out of it, and
+ *  the frames/sec, ns/byte and on-wire bytes/frame are reported over Serial for each
+ *  message type at a range of payload sizes. Run before and after changes to catch
+ *  regressions.
+ */
+
+#include <SerialComm.h>
+#include <Serialize.h>
+#include <LoopbackStream.h>
+
+#define LOOPBACK_SIZE     16384
+#define FRAMES_PER_ROUND  64
+#define NUM_ROUNDS        50
+#define FORMAT_ITERATIONS 10000
+#define SERIALIZE_VALUES  1024
+#define RECORD_FIELDS     40
+#define COMPRESS_SIZE     4096
+
+#ifndef F_CPU
+#define F_CPU 180000000
+#endif
+
+uint8_t loopback_buffer[LOOPBACK_SIZE];
+LoopbackStream loopback(loopback_buffer, LOOPBACK_SIZE);
+SerialComm ser(&loopback);
+
+uint8_t bin_tx[4096] = {0};
+uint8_t bin_rx[4096] = {0};
+char string_tx[STRING_BUFFER_SIZE] = {0};
+
+// worst case for incompressible data is a control byte per LZ_MAX_LITERALS bytes
+uint8_t compress_input[COMPRESS_SIZE] = {0};
+uint8_t compressed[COMPRESS_SIZE + COMPRESS_SIZE / LZ_MAX_LITERALS] = {0};
+uint8_t decompressed[COMPRESS_SIZE] = {0};
+
+float float_values[SERIALIZE_VALUES] = {0};
+uint8_t serialize_buffer[SERIALIZE_VALUES * sizeof(float)] = {0};
+
+typedef void (*TXFunction_t)(uint16_t size);
+
+// size is the number of parameters
+void Send_ASCII(uint16_t size)
+{
+  for (uint16_t i = 0; i < size; i++) {
+    ser.Add_uint32(1000000 + i);
+  }
+  ser.TX_ASCII(42);
+}
+
+void Send_Ack(uint16_t size)
+{
+  (void) size;
+  ser.TX_Ack(42, true);
+}
+
+// size is the number of bytes
+void Send_Bin(uint16_t size)
+{
+  ser.AssignBinaryTXBuffer(bin_tx, sizeof(bin_tx), size);
+  ser.TX_Bin(42);
+}
+
+// size is the string length
+void Send_String(uint16_t size)
+{
+  ser.TX_String(42, string_tx + (STRING_BUFFER_SIZE - 1 - size));
+}
+
+void Report(const char * direction, const char * name, uint16_t size, uint32_t frames, uint32_t bytes, uint32_t elapsed_us)
+{
+  if (0 == elapsed_us) elapsed_us = 1;
+
+  Serial.print(direction); Serial.print(" ");
+  Serial.print(name); Serial.print(" (");
+  Serial.print(size); Serial.print("): ");
+  Serial.print((float) frames * 1000000.0f / elapsed_us); Serial.print(" frames/s, ");
+  Serial.print((float) elapsed_us * 1000.0f / bytes); Serial.print(" ns/byte, ");
+  Serial.print((float) bytes / frames); Serial.println(" bytes/frame");
+}
+
+void Benchmark(const char * name, TXFunction_t tx_function, uint16_t size, SerialMessage_t expected)
+{
+  uint32_t tx_us = 0;
+  uint32_t rx_us = 0;
+  uint32_t frames = 0;
+  uint32_t bytes = 0;
+  uint32_t frames_per_round = FRAMES_PER_ROUND;
+  uint32_t received = 0;
+  uint32_t round_bytes = 0;
+  uint32_t start = 0;
+
+  // size a round so that it fits in the loopback buffer
+  loopback.clear();
+  tx_function(size);
+  if (loopback.bytes() * frames_per_round > LOOPBACK_SIZE) {
+    frames_per_round = LOOPBACK_SIZE / loopback.bytes();
+  }
+
+  for (int round = 0; round < NUM_ROUNDS; round++) {
+    loopback.clear();
+
+    start = micros();
+    for (uint32_t i = 0; i < frames_per_round; i++) {
+      tx_function(size);
+    }
+    tx_us += micros() - start;
+    round_bytes = loopback.bytes();
+
+    received = 0;
+    start = micros();
+    for (uint32_t i = 0; i < frames_per_round; i++) {
+      if (expected == ser.RX()) received++;
+    }
+    rx_us += micros() - start;
+
+    if (received != frames_per_round) {
+      Serial.print("RX "); Serial.print(name); Serial.println(": error, frames lost");
+      return;
+    }
+
+    frames += frames_per_round;
+    bytes += round_bytes;
+  }
+
+  Report("TX", name, size, frames, bytes, tx_us);
+  Report("RX", name, size, frames, bytes, rx_us);
+}
+
+// compare integer parameter formatting against the snprintf it replaced
+void BenchmarkFormatting()
+{
+  const uint32_t values[] = {7, 42, 255, 65535, 1000000, 4294967295};
+  const uint8_t num_values = sizeof(values) / sizeof(values[0]);
+  char buffer[16];
+  volatile char sink = 0;
+  uint32_t start = 0;
+  uint32_t snprintf_us = 0;
+  uint32_t add_us = 0;
+
+  start = micros();
+  for (uint32_t i = 0; i < FORMAT_ITERATIONS; i++) {
+    snprintf(buffer, 16, ",%u", (unsigned int) values[i % num_values]);
+    sink = buffer[1];
+  }
+  snprintf_us = micros() - start;
+
+  start = micros();
+  for (uint32_t i = 0; i < FORMAT_ITERATIONS; i++) {
+    ser.ascii_tx.buffer_index = 0;
+    ser.Add_uint32(values[i % num_values]);
+    sink = ser.ascii_tx.buffer[1];
+  }
+  add_us = micros() - start;
+  ser.ascii_tx.buffer_index = 0;
+
+  (void) sink;
+
+  Serial.print("snprintf: ");
+  Serial.print((float) snprintf_us * (F_CPU / 1000000) / FORMAT_ITERATIONS); Serial.println(" cycles/call");
+  Serial.print("Add_uint32: ");
+  Serial.print((float) add_us * (F_CPU / 1000000) / FORMAT_ITERATIONS); Serial.println(" cycles/call");
+}
+
+// compare the throughput of the block checksum against the byte-at-a-time definition (SerialComm_Test.ino
+// checks that they agree)
+void BenchmarkChecksum()
+{
+  uint8_t block_a = 0, block_b = 0, byte_a = 0, byte_b = 0;
+  uint32_t start = 0;
+  uint32_t block_us = 0;
+  uint32_t byte_us = 0;
+
+  start = micros();
+  for (int round = 0; round < NUM_ROUNDS; round++) {
+    SerialComm::BlockChecksum(bin_tx, sizeof(bin_tx), &block_a, &block_b);
+  }
+  block_us = micros() - start;
+
+  start = micros();
+  for (int round = 0; round < NUM_ROUNDS; round++) {
+    for (uint16_t i = 0; i < sizeof(bin_tx); i++) {
+      byte_a += bin_tx[i];
+      byte_b += byte_a;
+    }
+  }
+  byte_us = micros() - start;
+
+  if (block_a != byte_a || block_b != byte_b) Serial.println("FAILED checksum throughput test");
+
+  Serial.print("BlockChecksum: ");
+  Serial.print((float) block_us * 1000.0f / (NUM_ROUNDS * sizeof(bin_tx))); Serial.println(" ns/byte");
+  Serial.print("Byte checksum: ");
+  Serial.print((float) byte_us * 1000.0f / (NUM_ROUNDS * sizeof(bin_tx))); Serial.println(" ns/byte");
+}
+
+// compare serializing an array one value at a time against a single array call
+void BenchmarkSerialize(const char * name)
+{
+  uint16_t curr_index = 0;
+  uint32_t start = 0;
+  uint32_t value_us = 0;
+  uint32_t array_us = 0;
+
+  start = micros();
+  for (int round = 0; round < NUM_ROUNDS; round++) {
+    curr_index = 0;
+    for (uint16_t i = 0; i < SERIALIZE_VALUES; i++) {
+      BufferAddFloat(float_values[i], serialize_buffer, sizeof(serialize_buffer), &curr_index);
+    }
+  }
+  value_us = micros() - start;
+
+  start = micros();
+  for (int round = 0; round < NUM_ROUNDS; round++) {
+    curr_index = 0;
+    BufferAddFloatArray(float_values, SERIALIZE_VALUES, serialize_buffer, sizeof(serialize_buffer), &curr_index);
+  }
+  array_us = micros() - start;
+
+  Serial.print("BufferAddFloat ("); Serial.print(name); Serial.print("): ");
+  Serial.print((float) value_us * 1000.0f / (NUM_ROUNDS * SERIALIZE_VALUES)); Serial.println(" ns/value");
+  Serial.print("BufferAddFloatArray ("); Serial.print(name); Serial.print("): ");
+  Serial.print((float) array_us * 1000.0f / (NUM_ROUNDS * SERIALIZE_VALUES)); Serial.println(" ns/value");
+}
+
+// pack a telemetry record of alternating float and uint16_t fields, checking each field or reserving once
+void BenchmarkRecord()
+{
+  uint16_t curr_index = 0;
+  uint32_t start = 0;
+  uint32_t field_us = 0;
+  uint32_t reserve_us = 0;
+  BufferWriter<SERIALIZE_BIG_ENDIAN> writer(serialize_buffer, sizeof(serialize_buffer));
+
+  start = micros();
+  for (int round = 0; round < NUM_ROUNDS * FRAMES_PER_ROUND; round++) {
+    curr_index = 0;
+    for (uint16_t i = 0; i < RECORD_FIELDS; i += 2) {
+      BufferAddFloat(float_values[i], serialize_buffer, sizeof(serialize_buffer), &curr_index);
+      BufferAddUInt16(i, serialize_buffer, sizeof(serialize_buffer), &curr_index);
+    }
+  }
+  field_us = micros() - start;
+
+  start = micros();
+  for (int round = 0; round < NUM_ROUNDS * FRAMES_PER_ROUND; round++) {
+    writer.Reset();
+    if (!writer.Reserve(RECORD_FIELDS / 2 * (sizeof(float) + sizeof(uint16_t)))) break;
+    for (uint16_t i = 0; i < RECORD_FIELDS; i += 2) {
+      writer.Put(float_values[i]);
+      writer.Put(i);
+    }
+  }
+  reserve_us = micros() - start;
+
+  if (curr_index != writer.Index()) Serial.println("FAILED record size test");
+
+  Serial.print("Record, checked per field: ");
+  Serial.print((float) field_us * 1000.0f / (NUM_ROUNDS * FRAMES_PER_ROUND)); Serial.println(" ns/record");
+  Serial.print("Record, reserved once: ");
+  Serial.print((float) reserve_us * 1000.0f / (NUM_ROUNDS * FRAMES_PER_ROUND)); Serial.println(" ns/record");
+}
+
+// report the compression ratio and compress/decompress throughput for one kind of payload
+void BenchmarkCompression(const char * name)
+{
+  uint16_t compressed_length = 0;
+  uint16_t decompressed_length = 0;
+  uint32_t start = 0;
+  uint32_t compress_us = 0;
+  uint32_t decompress_us = 0;
+  LZ_DECODER_t decoder;
+
+  start = micros();
+  for (int round = 0; round < NUM_ROUNDS; round++) {
+    compressed_length = LZCompress(compress_input, COMPRESS_SIZE, compressed, sizeof(compressed));
+  }
+  compress_us = micros() - start;
+
+  start = micros();
+  for (int round = 0; round < NUM_ROUNDS; round++) {
+    LZResetDecoder(&decoder);
+    decompressed_length = 0;
+    LZDecode(&decoder, compressed, compressed_length, decompressed, sizeof(decompressed), &decompressed_length);
+  }
+  decompress_us = micros() - start;
+
+  if (0 == compress_us) compress_us = 1;
+  if (0 == decompress_us) decompress_us = 1;
+
+  if (COMPRESS_SIZE != decompressed_length || 0 != memcmp(compress_input, decompressed, COMPRESS_SIZE)) {
+    Serial.print("Compression ("); Serial.print(name); Serial.println("): error, round trip failed");
+    return;
+  }
+
+  // bytes/us is MB/s
+  Serial.print("Compression ("); Serial.print(name); Serial.print("): ");
+  Serial.print((float) COMPRESS_SIZE / compressed_length); Serial.print(" ratio, ");
+  Serial.print((float) NUM_ROUNDS * COMPRESS_SIZE / compress_us); Serial.print(" MB/s compress, ");
+  Serial.print((float) NUM_ROUNDS * COMPRESS_SIZE / decompress_us); Serial.println(" MB/s decompress");
+}
+
+void BenchmarkCompressionData()
+{
+  const char * log_line = "t=1234 state=NOMINAL temp=21.5 volts=12.1\n";
+  uint16_t curr_index = 0;
+  uint32_t seed = 12345;
+
+  // 16-bit samples of a periodic waveform, 256 samples per period
+  for (uint16_t i = 0; i < COMPRESS_SIZE / 2; i++) {
+    BufferAddInt16((int16_t) (1000.0f * sin(2.0f * PI * (i % 256) / 256.0f)), compress_input, COMPRESS_SIZE, &curr_index);
+  }
+  BenchmarkCompression("waveform");
+
+  for (uint16_t i = 0; i < COMPRESS_SIZE; i++) {
+    compress_input[i] = log_line[i % strlen(log_line)];
+  }
+  BenchmarkCompression("text");
+
+  for (uint16_t i = 0; i < COMPRESS_SIZE; i++) {
+    seed = seed * 1103515245 + 12345;
+    compress_input[i] = (uint8_t) (seed >> 16);
+  }
+  BenchmarkCompression("random");
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  delay(2500);
+
+  for (uint16_t i = 0; i < sizeof(bin_tx); i++) {
+    bin_tx[i] = (uint8_t) i;
+  }
+
+  for (uint16_t i = 0; i < STRING_BUFFER_SIZE - 1; i++) {
+    string_tx[i] = 'a' + (i % 26);
+  }
+
+  for (uint16_t i = 0; i < SERIALIZE_VALUES; i++) {
+    float_values[i] = 0.5f * i;
+  }
+
+  ser.AssignBinaryRXBuffer(bin_rx, sizeof(bin_rx));
+
+  Serial.println("SerialComm benchmark");
+
+  Benchmark("Ack", Send_Ack, 0, ACK_MESSAGE);
+
+  Benchmark("ASCII", Send_ASCII, 0, ASCII_MESSAGE);
+  Benchmark("ASCII", Send_ASCII, 4, ASCII_MESSAGE);
+  Benchmark("ASCII", Send_ASCII, 14, ASCII_MESSAGE);
+
+  Benchmark("String", Send_String, 16, STRING_MESSAGE);
+  Benchmark("String", Send_String, 64, STRING_MESSAGE);
+  Benchmark("String", Send_String, 127, STRING_MESSAGE);
+
+  Benchmark("Bin", Send_Bin, 16, BIN_MESSAGE);
+  Benchmark("Bin", Send_Bin, 256, BIN_MESSAGE);
+  Benchmark("Bin", Send_Bin, 1024, BIN_MESSAGE);
+  Benchmark("Bin", Send_Bin, 4096, BIN_MESSAGE);
+
+  // the same messages with compact framing
+  ser.SetFraming(FRAMING_COMPACT);
+
+  Benchmark("Compact Ack", Send_Ack, 0, ACK_MESSAGE);
+  Benchmark("Compact ASCII", Send_ASCII, 4, ASCII_MESSAGE);
+  Benchmark("Compact String", Send_String, 16, STRING_MESSAGE);
+  Benchmark("Compact Bin", Send_Bin, 16, BIN_MESSAGE);
+  Benchmark("Compact Bin", Send_Bin, 1024, BIN_MESSAGE);
+  Benchmark("Compact Bin", Send_Bin, 4096, BIN_MESSAGE);
+
+  ser.SetFraming(FRAMING_TEXT);
+
+  // the same binary messages, compressed, once the object has told itself (its own peer) that it can decompress
+  ser.AssignCompressionBuffer(compressed, sizeof(compressed));
+  loopback.clear();
+  ser.AnnounceCapabilities();
+  ser.RX();
+
+  if (ser.PeerCanDecompress()) {
+    Benchmark("Compressed Bin", Send_Bin, 256, BIN_MESSAGE);
+    Benchmark("Compressed Bin", Send_Bin, 4096, BIN_MESSAGE);
+  } else {
+    Serial.println("FAILED compression negotiation, compressed rows skipped");
+  }
+
+  ser.AssignCompressionBuffer(NULL, 0);
+
+  BenchmarkFormatting();
+  BenchmarkChecksum();
+
+  BenchmarkSerialize("big endian");
+  endianness = SERIALIZE_LITTLE_ENDIAN;
+  BenchmarkSerialize("little endian");
+  endianness = SERIALIZE_BIG_ENDIAN;
+  BenchmarkRecord();
+  BenchmarkCompressionData();
+
+  Serial.println("Conclusion of benchmark");
+}
+
+void loop()
+{
+  delay(500);
+}
@@ -4,9 +4,20 @@
  */
 
 #include <SerialComm.h>
+#include <LoopbackStream.h>
+
+#define TEST_DATA_SIZE 2000
 
 SerialComm ser(&Serial);
 
+// self tests run over an in-memory loopback at startup, before the interactive tests over Serial
+uint8_t loopback_buffer[4096] = {0};
+LoopbackStream loopback(loopback_buffer, sizeof(loopback_buffer));
+SerialComm loop_tx(&loopback);
+SerialComm loop_rx(&loopback);
+uint8_t loop_bin_rx[LARGE_BIN_FRAGMENT_SIZE + LARGE_BIN_HEADER_SIZE] = {0};
+uint8_t test_data[TEST_DATA_SIZE] = {0};
+
 uint8_t temp_u8 = 0;
 uint16_t temp_u16 = 0;
 uint32_t temp_u32 = 0;
@@ -20,10 +31,481 @@ uint8_t bin_rx[128] = {0};
 char bin_tx[] = "Readable test binary";
 uint16_t bin_tx_length = sizeof(bin_tx);
 
+// receive until a message comes out, or the loopback runs dry
+SerialMessage_t LoopRX()
+{
+  SerialMessage_t msg = NO_MESSAGE;
+
+  while (NO_MESSAGE == msg && loopback.available() > 0) {
+    msg = loop_rx.RX();
+  }
+
+  return msg;
+}
+
+uint8_t stream_copy[TEST_DATA_SIZE] = {0};
+uint16_t stream_bytes = 0;
+bool stream_in_order = true;
+
+void CopyStream(uint8_t bin_id, uint16_t offset, const uint8_t * bytes, uint16_t num_bytes, void * context)
+{
+  if (offset != stream_bytes || offset + num_bytes > sizeof(stream_copy)) {
+    stream_in_order = false;
+    return;
+  }
+
+  memcpy(stream_copy + offset, bytes, num_bytes);
+  stream_bytes += num_bytes;
+}
+
+uint8_t stream_ends = 0;
+uint16_t stream_end_length = 0;
+BinStreamResult_t stream_result = STREAM_DROPPED;
+
+void EndStream(uint8_t bin_id, uint16_t length, BinStreamResult_t result, void * context)
+{
+  stream_ends++;
+  stream_end_length = length;
+  stream_result = result;
+}
+
+uint8_t frame_copy[TEST_DATA_SIZE + 32] = {0};
+
+// a payload larger than the binary RX buffer is streamed to the handler in order, and the end handler is told
+// whether it arrived intact, arrived with a bad checksum, or was cut off
+void StreamTest()
+{
+  bool passed = true;
+  BIN_SEGMENT_t segment = {test_data, TEST_DATA_SIZE};
+  SerialMessage_t msg = NO_MESSAGE;
+  uint16_t length = 0;
+
+  loop_rx.AssignBinaryRXStream(CopyStream, EndStream, NULL);
+  loop_tx.TX_Bin(8, &segment, 1);
+  msg = loop_rx.RX();
+
+  if (BIN_MESSAGE != msg || !loop_rx.binary_rx.checksum_valid || TEST_DATA_SIZE != loop_rx.binary_rx.bin_length) passed = false;
+  if (!stream_in_order || TEST_DATA_SIZE != stream_bytes || 0 != memcmp(stream_copy, test_data, TEST_DATA_SIZE)) passed = false;
+  if (1 != stream_ends || STREAM_VALID != stream_result || TEST_DATA_SIZE != stream_end_length) passed = false;
+
+  // corrupt the payload on the way
+  stream_bytes = 0;
+  stream_ends = 0;
+  loop_tx.TX_Bin(8, &segment, 1);
+  length = loopback.bytes();
+  loopback.readBytes(frame_copy, length);
+  frame_copy[500] ^= 0x01;
+  loopback.write(frame_copy, length);
+  msg = LoopRX();
+  if (BIN_MESSAGE != msg || loop_rx.binary_rx.checksum_valid) passed = false;
+  if (1 != stream_ends || STREAM_INVALID != stream_result || TEST_DATA_SIZE != stream_end_length) passed = false;
+
+  // lose the end of the message, so it's dropped once it times out
+  stream_bytes = 0;
+  stream_ends = 0;
+  loop_tx.TX_Bin(8, &segment, 1);
+  length = loopback.bytes();
+  loopback.readBytes(frame_copy, length);
+  loopback.write(frame_copy, length - 100);
+  if (NO_MESSAGE != LoopRX() || 0 != stream_ends) passed = false;
+  delay(BIN_READ_TIMEOUT + 1);
+  if (NO_MESSAGE != loop_rx.RX()) passed = false;
+  if (1 != stream_ends || STREAM_DROPPED != stream_result || stream_bytes != stream_end_length
+      || stream_bytes >= TEST_DATA_SIZE) passed = false;
+
+  loop_rx.AssignBinaryRXStream(NULL, NULL);
+
+  if (passed) {
+    Serial.println("Passed stream test");
+  } else {
+    Serial.println("FAILED stream test");
+  }
+}
+
+uint8_t large_rx[TEST_DATA_SIZE] = {0};
+
+// an object larger than a binary message is reassembled from its fragments, and a lost fragment drops it
+void LargeBinTest()
+{
+  bool passed = true;
+  uint8_t lost[64];
+
+  loop_rx.AssignLargeBinaryRXBuffer(9, large_rx, sizeof(large_rx));
+
+  // lose the start of the first fragment, so the rest of the object is dropped
+  loop_tx.TX_Large_Bin(9, test_data, TEST_DATA_SIZE);
+  loopback.readBytes(lost, sizeof(lost));
+  if (NO_MESSAGE != LoopRX()) passed = false;
+
+  memset(large_rx, 0, sizeof(large_rx));
+  loop_tx.TX_Large_Bin(9, test_data, TEST_DATA_SIZE);
+  if (LARGE_BIN_MESSAGE != LoopRX() || !loop_rx.large_binary_rx.checksum_valid) passed = false;
+  if (TEST_DATA_SIZE != loop_rx.large_binary_rx.total_length || 0 != memcmp(large_rx, test_data, TEST_DATA_SIZE)) passed = false;
+
+  loop_rx.AssignLargeBinaryRXBuffer(0, NULL, 0);
+
+  if (passed) {
+    Serial.println("Passed large binary test");
+  } else {
+    Serial.println("FAILED large binary test");
+  }
+}
+
+uint8_t handled_id = 0;
+uint16_t handled_count = 0;
+
+void CountHandler(SerialComm * serial, uint8_t msg_id, void * context)
+{
+  handled_id = msg_id;
+  handled_count++;
+}
+
+// handlers are only called for their own messages, and the slots of unregistered handlers are reused
+void DispatchTest()
+{
+  bool passed = true;
+
+  // many more handlers than the table holds come and go, which only works if their slots are reused
+  for (uint16_t i = 0; i < 4 * HANDLER_TABLE_SIZE; i++) {
+    if (!loop_rx.RegisterHandler(ASCII_MESSAGE, (uint8_t) i, CountHandler, NULL)) passed = false;
+    loop_rx.UnregisterHandler(ASCII_MESSAGE, (uint8_t) i);
+  }
+
+  // fill the table, then free a single slot
+  for (uint16_t i = 0; i < HANDLER_TABLE_SIZE; i++) {
+    if (!loop_rx.RegisterHandler(ASCII_MESSAGE, (uint8_t) (100 + i), CountHandler, NULL)) passed = false;
+  }
+  if (loop_rx.RegisterHandler(ASCII_MESSAGE, 99, CountHandler, NULL)) passed = false;
+  loop_rx.UnregisterHandler(ASCII_MESSAGE, 103);
+
+  handled_count = 0;
+  loop_tx.TX_ASCII(105);
+  if (NO_MESSAGE != loop_rx.Dispatch() || 1 != handled_count || 105 != handled_id) passed = false;
+
+  // messages without a handler are returned instead
+  loop_tx.TX_ASCII(103);
+  if (ASCII_MESSAGE != loop_rx.Dispatch() || 103 != loop_rx.ascii_rx.msg_id || 1 != handled_count) passed = false;
+
+  for (uint16_t i = 0; i < HANDLER_TABLE_SIZE; i++) {
+    loop_rx.UnregisterHandler(ASCII_MESSAGE, (uint8_t) (100 + i));
+  }
+
+  // ids a table size apart share a probe sequence, and the last of them must still be found once the table has
+  // been rebuilt to clear the slots of the others
+  for (uint16_t i = 0; i < 8; i++) {
+    if (!loop_rx.RegisterHandler(ASCII_MESSAGE, (uint8_t) (5 + i * HANDLER_TABLE_SIZE), CountHandler, NULL)) passed = false;
+  }
+  for (uint16_t i = 0; i < 7; i++) {
+    loop_rx.UnregisterHandler(ASCII_MESSAGE, (uint8_t) (5 + i * HANDLER_TABLE_SIZE));
+  }
+  for (uint16_t i = 0; i < HANDLER_TOMBSTONES; i++) {
+    loop_rx.RegisterHandler(ACK_MESSAGE, (uint8_t) i, CountHandler, NULL);
+    loop_rx.UnregisterHandler(ACK_MESSAGE, (uint8_t) i);
+  }
+
+  handled_count = 0;
+  loop_tx.TX_ASCII((uint8_t) (5 + 7 * HANDLER_TABLE_SIZE));
+  if (NO_MESSAGE != loop_rx.Dispatch() || 1 != handled_count) passed = false;
+  loop_tx.TX_ASCII(5);
+  if (ASCII_MESSAGE != loop_rx.Dispatch() || 1 != handled_count) passed = false;
+  loop_rx.UnregisterHandler(ASCII_MESSAGE, (uint8_t) (5 + 7 * HANDLER_TABLE_SIZE));
+
+  if (passed) {
+    Serial.println("Passed dispatch test");
+  } else {
+    Serial.println("FAILED dispatch test");
+  }
+}
+
+// RXAll() stops at its frame budget, and at a message without a handler
+void RXAllTest()
+{
+  bool passed = true;
+
+  loop_rx.RegisterHandler(ASCII_MESSAGE, 120, CountHandler, NULL);
+  handled_count = 0;
+
+  for (uint8_t i = 0; i < 5; i++) {
+    loop_tx.TX_ASCII(120);
+  }
+  loop_tx.TX_ASCII(121);
+  loop_tx.TX_ASCII(120);
+
+  if (NO_MESSAGE != loop_rx.RXAll(2, 0) || 2 != handled_count) passed = false;
+  if (ASCII_MESSAGE != loop_rx.RXAll(0, 0) || 121 != loop_rx.ascii_rx.msg_id || 5 != handled_count) passed = false;
+  if (NO_MESSAGE != loop_rx.RXAll(0, 0) || 6 != handled_count || 0 != loopback.available()) passed = false;
+
+  loop_rx.UnregisterHandler(ASCII_MESSAGE, 120);
+
+  if (passed) {
+    Serial.println("Passed RXAll test");
+  } else {
+    Serial.println("FAILED RXAll test");
+  }
+}
+
+// line noise, and every byte of a message that's dropped part way through, is counted as discarded
+void DiscardTest()
+{
+  bool passed = true;
+  const uint8_t zero = 0;
+  BIN_SEGMENT_t segment = {test_data, 16};
+
+  loop_rx.discarded_bytes = 0;
+
+  // three bytes of noise, then a message broken by a bad id char which is noise itself
+  loopback.print("xyz#1x");
+  loop_tx.TX_ASCII(7);
+  if (ASCII_MESSAGE != LoopRX() || 7 != loop_rx.ascii_rx.msg_id || 6 != loop_rx.discarded_bytes) passed = false;
+
+  // a message that stops arriving part way through is dropped after the timeout
+  loopback.print("#12");
+  if (NO_MESSAGE != LoopRX()) passed = false;
+  delay(READ_TIMEOUT + 1);
+  loop_tx.TX_ASCII(8);
+  if (ASCII_MESSAGE != LoopRX() || 8 != loop_rx.ascii_rx.msg_id || 9 != loop_rx.discarded_bytes) passed = false;
+
+  // in text framing a zero byte is noise rather than the start of a compact frame, so no message is lost to it
+  loopback.write(&zero, 1);
+  loop_tx.TX_ASCII(9);
+  if (ASCII_MESSAGE != LoopRX() || 9 != loop_rx.ascii_rx.msg_id || 10 != loop_rx.discarded_bytes) passed = false;
+
+  loopback.write(&zero, 1);
+  loop_tx.TX_Ack(10, true);
+  if (ACK_MESSAGE != LoopRX() || 10 != loop_rx.ack_id || 11 != loop_rx.discarded_bytes) passed = false;
+
+  loopback.write(&zero, 1);
+  loop_tx.TX_Bin(11, &segment, 1);
+  if (BIN_MESSAGE != LoopRX() || 11 != loop_rx.binary_rx.bin_id || !loop_rx.binary_rx.checksum_valid
+      || 12 != loop_rx.discarded_bytes) passed = false;
+
+  loopback.write(&zero, 1);
+  loop_tx.TX_String(12, "text");
+  if (STRING_MESSAGE != LoopRX() || 12 != loop_rx.string_rx.str_id || 13 != loop_rx.discarded_bytes) passed = false;
+
+  if (passed) {
+    Serial.println("Passed discard test");
+  } else {
+    Serial.println("FAILED discard test");
+  }
+}
+
+// compact framing is only used once both ends have offered it, and frames round trip in it
+void FramingTest()
+{
+  bool passed = true;
+  uint16_t value = 0;
+  uint8_t frame[128];
+  uint16_t length = 0;
+  SerialMessage_t msg = NO_MESSAGE;
+  bool got_valid = false;
+  BIN_SEGMENT_t segment = {test_data, 100};
+
+  // an object that hasn't offered compact framing itself ignores the offer
+  loop_tx.NegotiateFraming();
+  if (NO_MESSAGE != LoopRX() || FRAMING_TEXT != loop_rx.GetFraming() || FRAMING_TEXT != loop_tx.GetFraming()) passed = false;
+
+  // once it has, the offer switches it, and its reply switches the peer
+  loop_rx.NegotiateFraming();
+  if (FRAMING_MESSAGE != loop_tx.RX() || FRAMING_COMPACT != loop_tx.GetFraming()) passed = false;
+  if (FRAMING_MESSAGE != LoopRX() || FRAMING_COMPACT != loop_rx.GetFraming()) passed = false;
+  if (NO_MESSAGE != loop_tx.RX() || 0 != loopback.available()) passed = false;
+
+  loop_tx.Add_uint16(4321);
+  loop_tx.TX_ASCII(30);
+  if (ASCII_MESSAGE != LoopRX() || 30 != loop_rx.ascii_rx.msg_id || !loop_rx.ascii_rx.checksum_valid) passed = false;
+  if (!loop_rx.Get_uint16(&value) || 4321 != value) passed = false;
+
+  loop_tx.TX_Ack(31, true);
+  if (ACK_MESSAGE != LoopRX() || 31 != loop_rx.ack_id || !loop_rx.ack_value || !loop_rx.ack_checksum) passed = false;
+
+  loop_tx.TX_String(32, "compact");
+  if (STRING_MESSAGE != LoopRX() || 32 != loop_rx.string_rx.str_id || !loop_rx.Get_string(temp_buffer, 128)
+      || 0 != strcmp(temp_buffer, "compact")) passed = false;
+
+  loop_tx.TX_Bin(33, &segment, 1);
+  if (BIN_MESSAGE != LoopRX() || 33 != loop_rx.binary_rx.bin_id || !loop_rx.binary_rx.checksum_valid
+      || 100 != loop_rx.binary_rx.bin_length || 0 != memcmp(loop_bin_rx, test_data, 100)) passed = false;
+
+  // a corrupted frame is either dropped or flagged, and the valid frame after it still comes through
+  loop_tx.TX_Bin(34, &segment, 1);
+  length = loopback.bytes();
+  if (length > sizeof(frame)) length = sizeof(frame);
+  loopback.readBytes(frame, length);
+  frame[length / 2] ^= 0x10;
+  loopback.write(frame, length);
+  loop_tx.TX_Bin(35, &segment, 1);
+
+  while (NO_MESSAGE != (msg = LoopRX())) {
+    if (BIN_MESSAGE != msg || !loop_rx.binary_rx.checksum_valid) continue;
+
+    if (35 == loop_rx.binary_rx.bin_id && 100 == loop_rx.binary_rx.bin_length && 0 == memcmp(loop_bin_rx, test_data, 100)) {
+      got_valid = true;
+    } else {
+      passed = false;
+    }
+  }
+  if (!got_valid) passed = false;
+
+  loop_tx.SetFraming(FRAMING_TEXT);
+  loop_rx.SetFraming(FRAMING_TEXT);
+
+  if (passed) {
+    Serial.println("Passed framing test");
+  } else {
+    Serial.println("FAILED framing test");
+  }
+}
+
+// parameters can be read out of order by number, and a run of floats can be read at once
+void ParamTest()
+{
+  bool passed = true;
+  float values[4] = {0.0f};
+
+  loop_tx.Add_uint8(200);
+  loop_tx.Add_uint16(60000);
+  loop_tx.Add_uint32(4000000000);
+  loop_tx.Add_int8(-100);
+  loop_tx.Add_int16(-30000);
+  loop_tx.Add_int32(-2000000000);
+  loop_tx.Add_float(1.5f);
+  loop_tx.TX_ASCII(40);
+  if (ASCII_MESSAGE != LoopRX() || 40 != loop_rx.ascii_rx.msg_id) passed = false;
+
+  if (!loop_rx.Get_float(6, &temp_float) || 1.5f != temp_float) passed = false;
+  if (!loop_rx.Get_int8(3, &temp_i8) || -100 != temp_i8) passed = false;
+  if (!loop_rx.Get_uint32(2, &temp_u32) || 4000000000 != temp_u32) passed = false;
+  if (!loop_rx.Get_uint8(0, &temp_u8) || 200 != temp_u8) passed = false;
+  if (!loop_rx.Get_uint16(1, &temp_u16) || 60000 != temp_u16) passed = false;
+  if (!loop_rx.Get_int16(4, &temp_i16) || -30000 != temp_i16) passed = false;
+
+  // the buffer is left after the parameter that was read, and there's no eighth parameter
+  if (!loop_rx.Get_int32(&temp_i32) || -2000000000 != temp_i32) passed = false;
+  if (loop_rx.Get_int32(7, &temp_i32)) passed = false;
+
+  loop_tx.Add_float(1.5f);
+  loop_tx.Add_float(-2.25f);
+  loop_tx.Add_float(100.125f);
+  loop_tx.TX_ASCII(41);
+  if (ASCII_MESSAGE != LoopRX() || 41 != loop_rx.ascii_rx.msg_id) passed = false;
+  if (!loop_rx.Get_floats(values, 3) || 1.5f != values[0] || -2.25f != values[1] || 100.125f != values[2]) passed = false;
+  if (loop_rx.Get_floats(values, 4)) passed = false;
+
+  if (passed) {
+    Serial.println("Passed parameter test");
+  } else {
+    Serial.println("FAILED parameter test");
+  }
+}
+
+uint8_t compress_buffer[512] = {0};
+
+// binary messages are only compressed once the peer has announced that it can decompress them
+void CompressionTest()
+{
+  bool passed = true;
+  BIN_SEGMENT_t segment = {test_data, 500};
+
+  loop_tx.AssignCompressionBuffer(compress_buffer, sizeof(compress_buffer));
+
+  // the framing test already announced that loop_rx can decompress, which an announcement without a buffer undoes
+  loop_rx.AssignBinaryRXBuffer(NULL, 0);
+  loop_rx.AnnounceCapabilities();
+  loop_rx.AssignBinaryRXBuffer(loop_bin_rx, sizeof(loop_bin_rx));
+  if (NO_MESSAGE != loop_tx.RX() || loop_tx.PeerCanDecompress()) passed = false;
+
+  loop_tx.TX_Bin(50, &segment, 1);
+  if (BIN_DELIMITER != loopback.peek()) passed = false;
+  if (BIN_MESSAGE != LoopRX() || !loop_rx.binary_rx.checksum_valid || 500 != loop_rx.binary_rx.bin_length) passed = false;
+
+  loop_rx.AnnounceCapabilities();
+  if (NO_MESSAGE != loop_tx.RX() || !loop_tx.PeerCanDecompress()) passed = false;
+
+  loop_tx.TX_Bin(51, &segment, 1);
+  if (COMPRESSED_BIN_DELIMITER != loopback.peek() || loopback.bytes() >= 500) passed = false;
+  if (BIN_MESSAGE != LoopRX() || 51 != loop_rx.binary_rx.bin_id || !loop_rx.binary_rx.checksum_valid
+      || 500 != loop_rx.binary_rx.bin_length || 0 != memcmp(loop_bin_rx, test_data, 500)) passed = false;
+
+  // a compressed message is streamed as it's decoded
+  stream_bytes = 0;
+  stream_in_order = true;
+  loop_rx.AssignBinaryRXStream(CopyStream, NULL);
+  loop_tx.TX_Bin(52, &segment, 1);
+  if (COMPRESSED_BIN_DELIMITER != loopback.peek()) passed = false;
+  if (BIN_MESSAGE != LoopRX() || !loop_rx.binary_rx.checksum_valid || !stream_in_order || 500 != stream_bytes
+      || 0 != memcmp(stream_copy, test_data, 500)) passed = false;
+
+  // a receiver that only streams can't decompress, so it's sent uncompressed messages
+  stream_bytes = 0;
+  loop_rx.AssignBinaryRXBuffer(NULL, 0);
+  loop_rx.AnnounceCapabilities();
+  if (NO_MESSAGE != loop_tx.RX() || loop_tx.PeerCanDecompress()) passed = false;
+  loop_tx.TX_Bin(53, &segment, 1);
+  if (BIN_DELIMITER != loopback.peek()) passed = false;
+  if (BIN_MESSAGE != LoopRX() || !loop_rx.binary_rx.checksum_valid || !stream_in_order || 500 != stream_bytes
+      || 0 != memcmp(stream_copy, test_data, 500)) passed = false;
+
+  loop_rx.AssignBinaryRXStream(NULL, NULL);
+  loop_rx.AssignBinaryRXBuffer(loop_bin_rx, sizeof(loop_bin_rx));
+  loop_tx.AssignCompressionBuffer(NULL, 0);
+
+  if (passed) {
+    Serial.println("Passed compression test");
+  } else {
+    Serial.println("FAILED compression test");
+  }
+}
+
+// the block checksum matches the byte-at-a-time definition at every length and alignment, from any start
+void ChecksumTest()
+{
+  bool passed = true;
+  uint8_t block_a, block_b, byte_a, byte_b;
+
+  for (uint16_t offset = 0; offset < 16; offset++) {
+    for (uint16_t length = 0; length < TEST_DATA_SIZE - 16; length += (length < 80) ? 1 : 61) {
+      block_a = byte_a = (uint8_t) (length * 3);
+      block_b = byte_b = (uint8_t) (offset * 5);
+
+      SerialComm::BlockChecksum(test_data + offset, length, &block_a, &block_b);
+      for (uint16_t i = 0; i < length; i++) {
+        byte_a += test_data[offset + i];
+        byte_b += byte_a;
+      }
+
+      if (block_a != byte_a || block_b != byte_b) passed = false;
+    }
+  }
+
+  if (passed) {
+    Serial.println("Passed checksum test");
+  } else {
+    Serial.println("FAILED checksum test");
+  }
+}
+
 void setup()
 {
   Serial.begin(115200);
   delay(2500);
+
+  for (uint16_t i = 0; i < TEST_DATA_SIZE; i++) {
+    test_data[i] = (uint8_t) (7 * i + 3);
+  }
+
+  loop_rx.AssignBinaryRXBuffer(loop_bin_rx, sizeof(loop_bin_rx));
+
+  ChecksumTest();
+  StreamTest();
+  LargeBinTest();
+  DispatchTest();
+  RXAllTest();
+  DiscardTest();
+  FramingTest();
+  ParamTest();
+  CompressionTest();
+
   Serial.println("Ready for messages");
 
   ser.AssignBinaryRXBuffer(bin_rx, 128);
@@ -31,16 +31,105 @@ float float_out = 0;
 uint8_t test_buffer[128] = {0};
 uint16_t curr_index = 0;
 
+// arrays are an odd length to cover both the bulk and per-value paths
+#define ARRAY_LENGTH 11
+
+uint16_t u16_array_in[ARRAY_LENGTH] = {0};
+uint16_t u16_array_out[ARRAY_LENGTH] = {0};
+
+uint32_t u32_array_in[ARRAY_LENGTH] = {0};
+
+int32_t i32_array_in[ARRAY_LENGTH] = {0};
+int32_t i32_array_out[ARRAY_LENGTH] = {0};
+
+float float_array_in[ARRAY_LENGTH] = {0};
+float float_array_out[ARRAY_LENGTH] = {0};
+
+uint8_t array_buffer[128] = {0};
+
 // test result variables
 bool size_test = true;
 bool input_test = true;
 bool output_test = true;
+bool array_test = true;
+bool template_test = true;
+bool cursor_test = true;
+bool varint_test = true;
+bool record_test = true;
+bool size32_test = true;
+uint32_t curr_index32 = 0;
+
+typedef BufferRecord<SERIALIZE_BIG_ENDIAN, uint8_t, uint16_t, uint32_t, int8_t, int16_t, int32_t, float> Test_Record;
+static_assert(18 == Test_Record::size, "record size is computed at compile time");
+
+// each value must encode to the expected length and decode back to itself
+bool VarintTest(uint32_t value, uint8_t expected_size)
+{
+  uint32_t value_out = 0;
+  int32_t signed_out = 0;
+  bool passed = true;
+
+  curr_index = 0;
+  passed &= BufferAddVarUInt32(value, test_buffer, 128, &curr_index);
+  passed &= (expected_size == curr_index);
+  curr_index = 0;
+  passed &= BufferGetVarUInt32(&value_out, test_buffer, 128, &curr_index);
+  passed &= (value == value_out) && (expected_size == curr_index);
+
+  // the same value read as zigzag, then written back
+  curr_index = 0;
+  passed &= BufferGetVarInt32(&signed_out, test_buffer, 128, &curr_index);
+  curr_index = 0;
+  passed &= BufferAddVarInt32(signed_out, array_buffer, 128, &curr_index);
+  passed &= (expected_size == curr_index) && (0 == memcmp(test_buffer, array_buffer, expected_size));
+
+  return passed;
+}
+
+// the array functions must produce the same bytes as adding each value individually
+bool ArrayTest()
+{
+  bool passed = true;
+
+  // start at an odd index so that the buffer is unaligned
+  curr_index = 1;
+  for (uint8_t i = 0; i < ARRAY_LENGTH; i++) passed &= BufferAddUInt16(u16_array_in[i], test_buffer, 128, &curr_index);
+  for (uint8_t i = 0; i < ARRAY_LENGTH; i++) passed &= BufferAddInt32(i32_array_in[i], test_buffer, 128, &curr_index);
+  for (uint8_t i = 0; i < ARRAY_LENGTH; i++) passed &= BufferAddFloat(float_array_in[i], test_buffer, 128, &curr_index);
+
+  curr_index = 1;
+  passed &= BufferAddUInt16Array(u16_array_in, ARRAY_LENGTH, array_buffer, 128, &curr_index);
+  passed &= BufferAddInt32Array(i32_array_in, ARRAY_LENGTH, array_buffer, 128, &curr_index);
+  passed &= BufferAddFloatArray(float_array_in, ARRAY_LENGTH, array_buffer, 128, &curr_index);
+  passed &= (1 + ARRAY_LENGTH * 10 == curr_index);
+  passed &= (0 == memcmp(test_buffer + 1, array_buffer + 1, ARRAY_LENGTH * 10));
+
+  // the array must fit entirely, or nothing is written
+  passed &= !BufferAddUInt16Array(u16_array_in, ARRAY_LENGTH, array_buffer, 128, &curr_index);
+  passed &= (1 + ARRAY_LENGTH * 10 == curr_index);
+
+  curr_index = 1;
+  passed &= BufferGetUInt16Array(u16_array_out, ARRAY_LENGTH, array_buffer, 128, &curr_index);
+  passed &= BufferGetInt32Array(i32_array_out, ARRAY_LENGTH, array_buffer, 128, &curr_index);
+  passed &= BufferGetFloatArray(float_array_out, ARRAY_LENGTH, array_buffer, 128, &curr_index);
+  passed &= (0 == memcmp(u16_array_in, u16_array_out, sizeof(u16_array_in)));
+  passed &= (0 == memcmp(i32_array_in, i32_array_out, sizeof(i32_array_in)));
+  passed &= (0 == memcmp(float_array_in, float_array_out, sizeof(float_array_in)));
+
+  return passed;
+}
 
 void setup()
 {
   Serial.begin(115200);
   delay(2500);
 
+  for (uint8_t i = 0; i < ARRAY_LENGTH; i++) {
+    u16_array_in[i] = u16_in + 257 * i;
+    i32_array_in[i] = i32_in + 65793 * i;
+    float_array_in[i] = float_in * (i + 1);
+  }
+
   size_test &= !BufferAddUInt8(u8_in, test_buffer, 0, &curr_index);
   size_test &= !BufferAddUInt16(u16_in, test_buffer, 0, &curr_index);
   size_test &= !BufferAddUInt32(u32_in, test_buffer, 0, &curr_index);
@@ -109,6 +198,14 @@ void setup()
     Serial.println("FAILED output test (big endian)");
   }
 
+  array_test = ArrayTest();
+
+  if (array_test) {
+    Serial.println("Passed array test  (big endian)");
+  } else {
+    Serial.println("FAILED array test  (big endian)");
+  }
+
   // switch to little endian
   endianness = SERIALIZE_LITTLE_ENDIAN;
 
@@ -151,6 +248,191 @@ void setup()
     Serial.println("FAILED output test (little endian)");
   }
 
+  array_test = ArrayTest();
+
+  if (array_test) {
+    Serial.println("Passed array test  (little endian)");
+  } else {
+    Serial.println("FAILED array test  (little endian)");
+  }
+
+  // the compile-time byte order must match the global one, whatever the global is set to
+  curr_index = 0;
+  template_test &= BufferAddUInt32(u32_in, test_buffer, 128, &curr_index);
+  template_test &= BufferAddFloat(float_in, test_buffer, 128, &curr_index);
+
+  endianness = SERIALIZE_BIG_ENDIAN;
+
+  curr_index = 0;
+  template_test &= BufferAdd<SERIALIZE_LITTLE_ENDIAN>(u32_in, array_buffer, 128, &curr_index);
+  template_test &= BufferAdd<SERIALIZE_LITTLE_ENDIAN>(float_in, array_buffer, 128, &curr_index);
+  template_test &= (0 == memcmp(test_buffer, array_buffer, 8));
+
+  curr_index = 0;
+  template_test &= BufferGet<SERIALIZE_LITTLE_ENDIAN>(&u32_out, test_buffer, 128, &curr_index);
+  template_test &= BufferGet<SERIALIZE_LITTLE_ENDIAN>(&float_out, test_buffer, 128, &curr_index);
+  template_test &= (u32_in == u32_out);
+  template_test &= (float_in == float_out);
+
+  if (template_test) {
+    Serial.println("Passed template test");
+  } else {
+    Serial.println("FAILED template test");
+  }
+
+  // a reserved record must match the named functions, and errors must be sticky
+  curr_index = 0;
+  cursor_test &= BufferAddUInt8(u8_in, test_buffer, 128, &curr_index);
+  cursor_test &= BufferAddUInt16(u16_in, test_buffer, 128, &curr_index);
+  cursor_test &= BufferAddUInt32(u32_in, test_buffer, 128, &curr_index);
+  cursor_test &= BufferAddInt8(i8_in, test_buffer, 128, &curr_index);
+  cursor_test &= BufferAddInt16(i16_in, test_buffer, 128, &curr_index);
+  cursor_test &= BufferAddInt32(i32_in, test_buffer, 128, &curr_index);
+  cursor_test &= BufferAddFloat(float_in, test_buffer, 128, &curr_index);
+
+  BufferWriter<SERIALIZE_BIG_ENDIAN> writer(array_buffer, 128);
+  cursor_test &= writer.Reserve(curr_index);
+  writer.Put(u8_in);
+  writer.Put(u16_in);
+  writer.Put(u32_in);
+  writer.Put(i8_in);
+  writer.Put(i16_in);
+  writer.Put(i32_in);
+  writer.Put(float_in);
+  cursor_test &= (curr_index == writer.Index());
+  cursor_test &= (0 == memcmp(test_buffer, array_buffer, curr_index));
+
+  BufferReader<SERIALIZE_BIG_ENDIAN> reader(array_buffer, writer.Index());
+  cursor_test &= reader.Reserve(writer.Index());
+  reader.Take(&u8_out);
+  reader.Take(&u16_out);
+  reader.Take(&u32_out);
+  reader.Take(&i8_out);
+  reader.Take(&i16_out);
+  reader.Take(&i32_out);
+  reader.Take(&float_out);
+  cursor_test &= (u8_in == u8_out) && (u16_in == u16_out) && (u32_in == u32_out);
+  cursor_test &= (i8_in == i8_out) && (i16_in == i16_out) && (i32_in == i32_out);
+  cursor_test &= (float_in == float_out);
+  cursor_test &= (0 == reader.Remaining());
+  cursor_test &= !reader.Get(&u8_out);
+  cursor_test &= reader.Error();
+
+  BufferWriter<SERIALIZE_BIG_ENDIAN> small_writer(array_buffer, 6);
+  cursor_test &= small_writer.Add(u32_in);
+  cursor_test &= !small_writer.Add(u32_in);
+  cursor_test &= !small_writer.Add(u8_in);
+  cursor_test &= small_writer.Error();
+  cursor_test &= (4 == small_writer.Index());
+
+  if (cursor_test) {
+    Serial.println("Passed cursor test");
+  } else {
+    Serial.println("FAILED cursor test");
+  }
+
+  varint_test &= VarintTest(0, 1);
+  varint_test &= VarintTest(127, 1);
+  varint_test &= VarintTest(128, 2);
+  varint_test &= VarintTest(16383, 2);
+  varint_test &= VarintTest(16384, 3);
+  varint_test &= VarintTest(u32_in, 5);
+  varint_test &= VarintTest(0xFFFFFFFF, 5);
+
+  // small negative numbers are short once zigzag encoded
+  curr_index = 0;
+  varint_test &= BufferAddVarInt32(-64, test_buffer, 128, &curr_index);
+  varint_test &= BufferAddVarInt32(i32_in, test_buffer, 128, &curr_index);
+  varint_test &= BufferAddVarInt32(INT32_MIN, test_buffer, 128, &curr_index);
+  varint_test &= (11 == curr_index);
+  curr_index = 0;
+  varint_test &= BufferGetVarInt32(&i32_out, test_buffer, 128, &curr_index) && (-64 == i32_out);
+  varint_test &= BufferGetVarInt32(&i32_out, test_buffer, 128, &curr_index) && (i32_in == i32_out);
+  varint_test &= BufferGetVarInt32(&i32_out, test_buffer, 128, &curr_index) && (INT32_MIN == i32_out);
+
+  // no partial writes or reads: a value that doesn't fit, a truncated value, and a value that's too long
+  curr_index = 125;
+  test_buffer[125] = 0;
+  varint_test &= !BufferAddVarUInt32(u32_in, test_buffer, 128, &curr_index);
+  varint_test &= (125 == curr_index) && (0 == test_buffer[125]);
+  curr_index = 0;
+  varint_test &= BufferAddVarUInt32(u32_in, test_buffer, 128, &curr_index);
+  curr_index = 0;
+  varint_test &= !BufferGetVarUInt32(&u32_out, test_buffer, 4, &curr_index);
+  varint_test &= (0 == curr_index);
+  memset(test_buffer, 0xFF, 6);
+  varint_test &= !BufferGetVarUInt32(&u32_out, test_buffer, 128, &curr_index);
+  varint_test &= (0 == curr_index);
+
+  if (varint_test) {
+    Serial.println("Passed varint test");
+  } else {
+    Serial.println("FAILED varint test");
+  }
+
+  // a record must match the named functions, and is only written or read whole
+  endianness = SERIALIZE_BIG_ENDIAN;
+  curr_index = 0;
+  record_test &= BufferAddUInt8(u8_in, test_buffer, 128, &curr_index);
+  record_test &= BufferAddUInt16(u16_in, test_buffer, 128, &curr_index);
+  record_test &= BufferAddUInt32(u32_in, test_buffer, 128, &curr_index);
+  record_test &= BufferAddInt8(i8_in, test_buffer, 128, &curr_index);
+  record_test &= BufferAddInt16(i16_in, test_buffer, 128, &curr_index);
+  record_test &= BufferAddInt32(i32_in, test_buffer, 128, &curr_index);
+  record_test &= BufferAddFloat(float_in, test_buffer, 128, &curr_index);
+
+  curr_index = 0;
+  record_test &= Test_Record::Pack(array_buffer, 128, &curr_index, u8_in, u16_in, u32_in, i8_in, i16_in, i32_in, float_in);
+  record_test &= (Test_Record::size == curr_index);
+  record_test &= (0 == memcmp(test_buffer, array_buffer, Test_Record::size));
+  curr_index = 128 - Test_Record::size + 1;
+  record_test &= !Test_Record::Pack(array_buffer, 128, &curr_index, u8_in, u16_in, u32_in, i8_in, i16_in, i32_in, float_in);
+  record_test &= (128 - Test_Record::size + 1 == curr_index);
+
+  u8_out = 0;
+  curr_index = 0;
+  record_test &= !Test_Record::Unpack(array_buffer, Test_Record::size - 1, &curr_index, &u8_out, &u16_out, &u32_out, &i8_out, &i16_out, &i32_out, &float_out);
+  record_test &= (0 == curr_index) && (0 == u8_out);
+  record_test &= Test_Record::Unpack(array_buffer, Test_Record::size, &curr_index, &u8_out, &u16_out, &u32_out, &i8_out, &i16_out, &i32_out, &float_out);
+  record_test &= (u8_in == u8_out) && (u16_in == u16_out) && (u32_in == u32_out);
+  record_test &= (i8_in == i8_out) && (i16_in == i16_out) && (i32_in == i32_out);
+  record_test &= (float_in == float_out);
+
+  if (record_test) {
+    Serial.println("Passed record test");
+  } else {
+    Serial.println("FAILED record test");
+  }
+
+  // a uint32_t index selects the 32-bit overloads, which must write the same bytes
+  curr_index32 = 0;
+  size32_test &= BufferAddUInt8(u8_in, array_buffer, 128, &curr_index32);
+  size32_test &= BufferAddUInt16(u16_in, array_buffer, 128, &curr_index32);
+  size32_test &= BufferAddUInt32(u32_in, array_buffer, 128, &curr_index32);
+  size32_test &= BufferAddInt8(i8_in, array_buffer, 128, &curr_index32);
+  size32_test &= BufferAddInt16(i16_in, array_buffer, 128, &curr_index32);
+  size32_test &= BufferAddInt32(i32_in, array_buffer, 128, &curr_index32);
+  size32_test &= BufferAddFloat(float_in, array_buffer, 128, &curr_index32);
+  size32_test &= (Test_Record::size == curr_index32);
+  size32_test &= (0 == memcmp(test_buffer, array_buffer, Test_Record::size));
+
+  curr_index32 = 0;
+  size32_test &= Test_Record::Unpack(array_buffer, 128, &curr_index32, &u8_out, &u16_out, &u32_out, &i8_out, &i16_out, &i32_out, &float_out);
+  size32_test &= (u8_in == u8_out) && (u32_in == u32_out) && (float_in == float_out);
+  size32_test &= BufferAddVarUInt32(u32_in, array_buffer, 128, &curr_index32);
+  size32_test &= BufferAddUInt16Array(u16_array_in, ARRAY_LENGTH, array_buffer, 128, &curr_index32);
+  size32_test &= !BufferAddUInt32Array(u32_array_in, 0xFFFFFFFF, array_buffer, 128, &curr_index32);
+  size32_test &= (Test_Record::size + 5 + 2 * ARRAY_LENGTH == curr_index32);
+
+  BufferWriter<SERIALIZE_BIG_ENDIAN, uint32_t> writer32(array_buffer, 128);
+  size32_test &= writer32.Add(u32_in) && !writer32.Reserve(0xFFFFFFFF) && (4 == writer32.Index());
+
+  if (size32_test) {
+    Serial.println("Passed 32-bit size test");
+  } else {
+    Serial.println("FAILED 32-bit size test");
+  }
+
   Serial.println("Conclusion of tests");
 }
 
@@ -0,0 +1,178 @@
+/*  TypedMessage_Test.ino
+ *
+ *  Sends typed ASCII messages over an in-memory loopback stream and parses them back. Checks
+ *  that every parameter type round trips at both ends of its range, and that a message with
+ *  the wrong number of parameters or a malformed parameter is rejected without writing any
+ *  of the outputs.
+ */
+
+#include <SerialComm.h>
+#include <TypedMessage.h>
+#include <LoopbackStream.h>
+
+// one of every parameter type
+typedef ASCIIMessage<1, uint8_t, uint16_t, uint32_t, int8_t, int16_t, int32_t, float> AllTypes;
+
+// the same id with a parameter missing
+typedef ASCIIMessage<1, uint8_t, uint16_t, uint32_t, int8_t, int16_t, int32_t> MissingParam;
+
+uint8_t loopback_buffer[512] = {0};
+LoopbackStream loopback(loopback_buffer, sizeof(loopback_buffer));
+SerialComm loop_tx(&loopback);
+SerialComm loop_rx(&loopback);
+
+// the parsed parameters, set to values that are never sent so that untouched outputs can be checked
+uint8_t rx_u8 = 0;
+uint16_t rx_u16 = 0;
+uint32_t rx_u32 = 0;
+int8_t rx_i8 = 0;
+int16_t rx_i16 = 0;
+int32_t rx_i32 = 0;
+float rx_float = 0.0f;
+
+void ResetOutputs()
+{
+  rx_u8 = 17;
+  rx_u16 = 17;
+  rx_u32 = 17;
+  rx_i8 = 17;
+  rx_i16 = 17;
+  rx_i32 = 17;
+  rx_float = 17.0f;
+}
+
+bool OutputsUntouched()
+{
+  return 17 == rx_u8 && 17 == rx_u16 && 17 == rx_u32 && 17 == rx_i8 && 17 == rx_i16 && 17 == rx_i32 && 17.0f == rx_float;
+}
+
+bool ReceiveAllTypes()
+{
+  ResetOutputs();
+  if (ASCII_MESSAGE != loop_rx.RX()) return false;
+  return AllTypes::RX(&loop_rx, &rx_u8, &rx_u16, &rx_u32, &rx_i8, &rx_i16, &rx_i32, &rx_float);
+}
+
+// every type comes back unchanged at the top and bottom of its range
+void ExtremesTest()
+{
+  bool passed = true;
+
+  AllTypes::TX(&loop_tx, UINT8_MAX, UINT16_MAX, UINT32_MAX, INT8_MIN, INT16_MIN, INT32_MIN, -1.17549435e-38f);
+  if (!ReceiveAllTypes()) passed = false;
+  if (UINT8_MAX != rx_u8 || UINT16_MAX != rx_u16 || UINT32_MAX != rx_u32) passed = false;
+  if (INT8_MIN != rx_i8 || INT16_MIN != rx_i16 || INT32_MIN != rx_i32 || -1.17549435e-38f != rx_float) passed = false;
+
+  AllTypes::TX(&loop_tx, 0, 0, 0, INT8_MAX, INT16_MAX, INT32_MAX, -3.40282347e+38f);
+  if (!ReceiveAllTypes()) passed = false;
+  if (0 != rx_u8 || 0 != rx_u16 || 0 != rx_u32) passed = false;
+  if (INT8_MAX != rx_i8 || INT16_MAX != rx_i16 || INT32_MAX != rx_i32 || -3.40282347e+38f != rx_float) passed = false;
+
+  AllTypes::TX(&loop_tx, 1, 2, 3, -1, -2, -3, -0.125f);
+  if (!ReceiveAllTypes()) passed = false;
+  if (1 != rx_u8 || 2 != rx_u16 || 3 != rx_u32 || -1 != rx_i8 || -2 != rx_i16 || -3 != rx_i32 || -0.125f != rx_float) passed = false;
+
+  if (passed) {
+    Serial.println("Passed extremes test");
+  } else {
+    Serial.println("FAILED extremes test");
+  }
+}
+
+// a message with too few or too many parameters, or another id, isn't parsed
+void CountTest()
+{
+  bool passed = true;
+
+  MissingParam::TX(&loop_tx, 1, 2, 3, 4, 5, 6);
+  if (ReceiveAllTypes() || !OutputsUntouched()) passed = false;
+
+  loop_tx.Add_uint8(1);
+  loop_tx.Add_uint16(2);
+  loop_tx.Add_uint32(3);
+  loop_tx.Add_int8(4);
+  loop_tx.Add_int16(5);
+  loop_tx.Add_int32(6);
+  loop_tx.Add_float(7.0f);
+  loop_tx.Add_float(8.0f);
+  loop_tx.TX_ASCII(1);
+  if (ReceiveAllTypes() || !OutputsUntouched()) passed = false;
+
+  AllTypes::TX(&loop_tx, 1, 2, 3, 4, 5, 6, 7.0f);
+  if (ASCII_MESSAGE != loop_rx.RX() || MissingParam::RX(&loop_rx, &rx_u8, &rx_u16, &rx_u32, &rx_i8, &rx_i16, &rx_i32)) passed = false;
+
+  loop_tx.Add_uint8(1);
+  loop_tx.Add_uint16(2);
+  loop_tx.Add_uint32(3);
+  loop_tx.Add_int8(4);
+  loop_tx.Add_int16(5);
+  loop_tx.Add_int32(6);
+  loop_tx.Add_float(7.0f);
+  loop_tx.TX_ASCII(2);
+  if (ReceiveAllTypes() || !OutputsUntouched()) passed = false;
+
+  if (passed) {
+    Serial.println("Passed parameter count test");
+  } else {
+    Serial.println("FAILED parameter count test");
+  }
+}
+
+// a parameter that doesn't parse as its type leaves every output as it was, including those before it
+void MalformedTest()
+{
+  bool passed = true;
+
+  // an int32 that doesn't fit, after parameters that would already have been written
+  loop_tx.Add_uint8(1);
+  loop_tx.Add_uint16(2);
+  loop_tx.Add_uint32(3);
+  loop_tx.Add_int8(4);
+  loop_tx.Add_int16(5);
+  loop_tx.Add_uint32(UINT32_MAX);
+  loop_tx.Add_float(7.0f);
+  loop_tx.TX_ASCII(1);
+  if (ReceiveAllTypes() || !OutputsUntouched()) passed = false;
+
+  // a uint8 that doesn't fit, at the front of the message
+  loop_tx.Add_uint16(256);
+  loop_tx.Add_uint16(2);
+  loop_tx.Add_uint32(3);
+  loop_tx.Add_int8(4);
+  loop_tx.Add_int16(5);
+  loop_tx.Add_int32(6);
+  loop_tx.Add_float(7.0f);
+  loop_tx.TX_ASCII(1);
+  if (ReceiveAllTypes() || !OutputsUntouched()) passed = false;
+
+  // a negative value for an unsigned parameter in the middle
+  loop_tx.Add_uint8(1);
+  loop_tx.Add_uint16(2);
+  loop_tx.Add_int32(-3);
+  loop_tx.Add_int8(4);
+  loop_tx.Add_int16(5);
+  loop_tx.Add_int32(6);
+  loop_tx.Add_float(7.0f);
+  loop_tx.TX_ASCII(1);
+  if (ReceiveAllTypes() || !OutputsUntouched()) passed = false;
+
+  if (passed) {
+    Serial.println("Passed malformed parameter test");
+  } else {
+    Serial.println("FAILED malformed parameter test");
+  }
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  delay(2500);
+
+  ExtremesTest();
+  CountTest();
+  MalformedTest();
+}
+
+void loop()
+{
+}
@@ -0,0 +1,49 @@
+/*
+ * Arduino.cpp
+ *
+ * This file implements the host stand-in for the Arduino core declared in Arduino.h.
+ */
+
+#include "Arduino.h"
+#include <chrono>
+
+HostSerial Serial;
+
+static const std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+
+// time added by delay(), and the fixed time once HostSetMillis() has been called
+static uint64_t skipped_us = 0;
+static uint64_t fixed_us = 0;
+static bool fixed = false;
+
+static uint64_t HostMicros()
+{
+    if (fixed) return fixed_us;
+
+    return (uint64_t) std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time).count() + skipped_us;
+}
+
+uint32_t millis()
+{
+    return (uint32_t) (HostMicros() / 1000);
+}
+
+uint32_t micros()
+{
+    return (uint32_t) HostMicros();
+}
+
+void delay(uint32_t ms)
+{
+    if (fixed) {
+        fixed_us += (uint64_t) ms * 1000;
+    } else {
+        skipped_us += (uint64_t) ms * 1000;
+    }
+}
+
+void HostSetMillis(uint32_t ms)
+{
+    fixed = true;
+    fixed_us = (uint64_t) ms * 1000;
+}
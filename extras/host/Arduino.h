@@ -0,0 +1,100 @@
+/*
+ * Arduino.h
+ *
+ * This file is a minimal stand-in for the Arduino core, just enough to build the library and
+ * the example sketches on a Linux host (see the CMakeLists.txt at the top of the repository).
+ * Serial prints to stdout and never has input. The clock follows real time, but delay()
+ * moves it forward instantly rather than sleeping, and HostSetMillis() stops it at a fixed
+ * time for tests that step it by hand.
+ */
+
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PI 3.1415926535897932384626433832795
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+
+// Host only: stop the clock at ms, after which only delay() and HostSetMillis() move it
+void HostSetMillis(uint32_t ms);
+
+class Print {
+public:
+    virtual ~Print() { }
+
+    virtual size_t write(uint8_t new_byte) = 0;
+    virtual size_t write(const uint8_t * bytes, size_t num_bytes)
+    {
+        size_t i = 0;
+        while (i < num_bytes && write(bytes[i])) i++;
+        return i;
+    }
+    size_t write(const char * bytes, size_t num_bytes) { return write((const uint8_t *) bytes, num_bytes); }
+
+    virtual int availableForWrite() { return 0; }
+    virtual void flush() { }
+
+    size_t print(const char * str) { return write((const uint8_t *) str, strlen(str)); }
+    size_t print(char value) { return write((uint8_t) value); }
+    size_t print(int value) { return Format("%d", value); }
+    size_t print(unsigned int value) { return Format("%u", value); }
+    size_t print(long value) { return Format("%ld", value); }
+    size_t print(unsigned long value) { return Format("%lu", value); }
+    size_t print(double value) { return Format("%.2f", value); } // two decimal places, as on the Arduino
+
+    size_t println() { return print("\r\n"); }
+    template <typename T> size_t println(T value) { return print(value) + println(); }
+
+private:
+    template <typename T> size_t Format(const char * format, T value)
+    {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), format, value);
+        return print(buffer);
+    }
+};
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    // there's nothing to wait for on the host, so a read stops as soon as the stream is empty
+    size_t readBytes(char * buffer, size_t length)
+    {
+        size_t count = 0;
+        int next = 0;
+
+        while (count < length && (next = read()) >= 0) buffer[count++] = (char) next;
+
+        return count;
+    }
+    size_t readBytes(uint8_t * buffer, size_t length) { return readBytes((char *) buffer, length); }
+};
+
+class HostSerial : public Stream {
+public:
+    void begin(unsigned long baud) { (void) baud; }
+
+    size_t write(uint8_t new_byte) { return (EOF != putchar(new_byte)) ? 1 : 0; }
+    int available() { return 0; }
+    int read() { return -1; }
+    int peek() { return -1; }
+    void flush() { fflush(stdout); }
+
+    using Print::write;
+};
+
+extern HostSerial Serial;
+
+#endif /* ARDUINO_H */
@@ -0,0 +1,26 @@
+/*
+ * sketch_main.cpp
+ *
+ * This file runs an example sketch on the host: setup() once, then loop() HOST_LOOPS times.
+ * HOST_SKETCH is the path of the sketch, set by the build.
+ */
+
+#include "Arduino.h"
+#include HOST_SKETCH
+
+#ifndef HOST_LOOPS
+#define HOST_LOOPS 10
+#endif
+
+int main()
+{
+    setup();
+
+    for (int i = 0; i < HOST_LOOPS; i++) {
+        loop();
+    }
+
+    Serial.flush();
+
+    return 0;
+}